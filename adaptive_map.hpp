@@ -0,0 +1,348 @@
+#pragma once
+// A map that picks its engine from the workload it sees:
+//
+//   Small    unsorted vector, linear scan; for maps that stay tiny
+//   Hashed   flat_unordered_map; point operations in O(1)
+//   Ordered  OrderedMap (balanced treap); range visits in O(log n + k)
+//
+// Small promotes once it grows past `Policy::promoteAt` and larger engines
+// demote back once the map shrinks below `Policy::demoteAt`; the gap
+// between the two keeps a map hovering around one size from flapping.
+//
+// Hashed and Ordered switch on "regret": an estimate, in element visits,
+// of the work the other engine would have saved. Hashed gains size() per
+// range query (a full scan where Ordered would visit only the matches) and
+// pays it back at log2(size) per point operation; Ordered does the reverse.
+// A switch happens once regret reaches `Policy::switchFactor` x size, i.e.
+// once the work already wasted covers the O(n) migration, so migrations
+// cost O(1) amortised per operation and an occasional range query on a
+// large map never triggers one.
+//
+// Every migration is logged with its reason and the counters behind it
+// (see decisions() and explain()).
+
+// Keep an includer's own SIMPLE_MAPS_NO_MAIN in effect after this block.
+#ifndef SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+#include "flat_buffered_unordered_map.cpp"
+#include "map.cpp"
+#ifdef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#undef SIMPLE_MAPS_NO_MAIN
+#undef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <utility>
+#include <vector>
+
+enum class AdaptiveMode : uint8_t { Small, Hashed, Ordered };
+
+inline const char* adaptiveModeName(AdaptiveMode m) {
+    switch (m) {
+    case AdaptiveMode::Small:   return "small";
+    case AdaptiveMode::Hashed:  return "hashed";
+    case AdaptiveMode::Ordered: return "ordered";
+    }
+    return "?";
+}
+
+template <class Key, class Value, class Hash = hashing::Hash<Key>>
+class AdaptiveMap {
+public:
+    struct Policy {
+        size_t promoteAt = 32;          // Small -> larger engine above this size
+        size_t demoteAt = 8;            // larger engine -> Small below this size
+        double switchFactor = 4.0;      // regret needed per element to switch engines
+        size_t logLimit = 64;           // decisions kept
+    };
+
+    enum class Reason : uint8_t {
+        Grew,               // Small outgrew promoteAt
+        Shrank,             // fell below demoteAt
+        RangeHeavy,         // Hashed -> Ordered: range scans outweigh point ops
+        PointHeavy,         // Ordered -> Hashed: point ops outweigh range queries
+    };
+
+    static const char* reasonName(Reason r) {
+        switch (r) {
+        case Reason::Grew:       return "grew";
+        case Reason::Shrank:     return "shrank";
+        case Reason::RangeHeavy: return "range-heavy";
+        case Reason::PointHeavy: return "point-heavy";
+        }
+        return "?";
+    }
+
+    // One migration and the counters that caused it.
+    struct Decision {
+        AdaptiveMode from, to;
+        Reason reason;
+        size_t size;                    // elements migrated
+        uint64_t pointOps;              // since the previous migration
+        uint64_t rangeQueries;          // since the previous migration
+        double regret;                  // at the time of the switch
+    };
+
+    struct Stats {
+        AdaptiveMode mode;
+        uint64_t pointOps = 0;
+        uint64_t rangeQueries = 0;
+        uint64_t migrations = 0;
+        uint64_t elementsMoved = 0;     // total migration work
+        double regret = 0;              // toward switching Hashed <-> Ordered
+    };
+
+private:
+    using Item = std::pair<Key, Value>;
+
+    Policy policy;
+    AdaptiveMode current = AdaptiveMode::Small;
+    std::vector<Item> small;
+    flat_unordered_map<Key, Value, Hash> hashed;
+    OrderedMap<Key, Value> ordered;
+
+    Stats totals{AdaptiveMode::Small};
+    uint64_t pointSince = 0, rangeSince = 0;
+    std::deque<Decision> log;
+
+    static double log2Of(size_t n) { return static_cast<double>(std::bit_width(n | 1)); }
+
+    // Everything out of the current engine, which is left empty.
+    std::vector<Item> drain() {
+        std::vector<Item> items;
+        items.reserve(size());
+        switch (current) {
+        case AdaptiveMode::Small:
+            items.swap(small);
+            break;
+        case AdaptiveMode::Hashed:
+            hashed.for_each([&](const Key& k, Value& v) { items.emplace_back(k, std::move(v)); });
+            hashed = flat_unordered_map<Key, Value, Hash>();
+            break;
+        case AdaptiveMode::Ordered:
+            ordered.forEach([&](const Key& k, Value& v) { items.emplace_back(k, std::move(v)); });
+            ordered.clear();
+            break;
+        }
+        return items;
+    }
+
+    void migrate(AdaptiveMode to, Reason reason) {
+        size_t n = size();
+        std::vector<Item> items = drain();
+        switch (to) {
+        case AdaptiveMode::Small:
+            small = std::move(items);
+            break;
+        case AdaptiveMode::Hashed:
+            hashed.reserve(items.size());
+            for (auto& [k, v] : items) hashed.insert_or_assign(std::move(k), std::move(v));
+            break;
+        case AdaptiveMode::Ordered:
+            if (current != AdaptiveMode::Ordered)
+                std::sort(items.begin(), items.end(),
+                          [](const Item& a, const Item& b) { return a.first < b.first; });
+            ordered.assignSorted(std::move(items));
+            break;
+        }
+
+        log.push_back({current, to, reason, n, pointSince, rangeSince, totals.regret});
+        while (log.size() > policy.logLimit) log.pop_front();
+        current = to;
+        totals.mode = to;
+        ++totals.migrations;
+        totals.elementsMoved += n;
+        totals.regret = 0;
+        pointSince = rangeSince = 0;
+    }
+
+    void afterPointOp() {
+        ++totals.pointOps;
+        ++pointSince;
+        size_t n = size();
+        switch (current) {
+        case AdaptiveMode::Small:
+            if (n > policy.promoteAt)
+                migrate(rangeSince * 4 > pointSince ? AdaptiveMode::Ordered : AdaptiveMode::Hashed, Reason::Grew);
+            return;
+        case AdaptiveMode::Hashed:
+            totals.regret = std::max(0.0, totals.regret - log2Of(n));
+            break;
+        case AdaptiveMode::Ordered:
+            totals.regret += log2Of(n);
+            if (totals.regret >= policy.switchFactor * static_cast<double>(n)) {
+                migrate(AdaptiveMode::Hashed, Reason::PointHeavy);
+                return;
+            }
+            break;
+        }
+        if (n < policy.demoteAt) migrate(AdaptiveMode::Small, Reason::Shrank);
+    }
+
+    void afterRangeQuery(size_t visited) {
+        ++totals.rangeQueries;
+        ++rangeSince;
+        size_t n = size();
+        double saved = static_cast<double>(n > visited ? n - visited : 0);
+        if (current == AdaptiveMode::Hashed) {
+            totals.regret += saved;
+            if (totals.regret >= policy.switchFactor * static_cast<double>(n))
+                migrate(AdaptiveMode::Ordered, Reason::RangeHeavy);
+        } else if (current == AdaptiveMode::Ordered) {
+            totals.regret = std::max(0.0, totals.regret - saved);
+        }
+    }
+
+    Item* findSmall(const Key& key) {
+        for (auto& item : small)
+            if (item.first == key) return &item;
+        return nullptr;
+    }
+
+public:
+    AdaptiveMap() = default;
+    explicit AdaptiveMap(Policy p) : policy(p) {}
+
+    AdaptiveMode mode() const { return current; }
+
+    size_t size() const {
+        switch (current) {
+        case AdaptiveMode::Small:   return small.size();
+        case AdaptiveMode::Hashed:  return hashed.size();
+        case AdaptiveMode::Ordered: return ordered.size();
+        }
+        return 0;
+    }
+
+    // insert or assign; true if the key was new
+    bool insert(const Key& key, const Value& value) {
+        bool inserted = false;
+        switch (current) {
+        case AdaptiveMode::Small:
+            if (Item* item = findSmall(key)) {
+                item->second = value;
+            } else {
+                small.emplace_back(key, value);
+                inserted = true;
+            }
+            break;
+        case AdaptiveMode::Hashed:
+            inserted = hashed.insert_or_assign(key, value).first;
+            break;
+        case AdaptiveMode::Ordered:
+            inserted = ordered.insert(key, value);
+            break;
+        }
+        afterPointOp();
+        return inserted;
+    }
+
+    // Pointer stays valid until the next insert or erase (which may migrate).
+    Value* find(const Key& key) {
+        Value* v = nullptr;
+        switch (current) {
+        case AdaptiveMode::Small:
+            if (Item* item = findSmall(key)) v = &item->second;
+            break;
+        case AdaptiveMode::Hashed:
+            v = hashed.find(key);
+            break;
+        case AdaptiveMode::Ordered:
+            v = ordered.find(key);
+            break;
+        }
+        // Lookups count toward regret but never migrate, so `v` stays valid.
+        ++totals.pointOps;
+        ++pointSince;
+        if (current == AdaptiveMode::Hashed)
+            totals.regret = std::max(0.0, totals.regret - log2Of(size()));
+        else if (current == AdaptiveMode::Ordered)
+            totals.regret += log2Of(size());
+        return v;
+    }
+
+    bool erase(const Key& key) {
+        bool erased = false;
+        switch (current) {
+        case AdaptiveMode::Small:
+            if (Item* item = findSmall(key)) {
+                *item = std::move(small.back());
+                small.pop_back();
+                erased = true;
+            }
+            break;
+        case AdaptiveMode::Hashed:
+            erased = hashed.erase(key);
+            break;
+        case AdaptiveMode::Ordered:
+            erased = ordered.erase(key);
+            break;
+        }
+        afterPointOp();
+        return erased;
+    }
+
+    // Visit keys in [lo, hi) in ascending order: fn(const Key&, Value&).
+    template <class Fn>
+    void forEachInRange(const Key& lo, const Key& hi, Fn&& fn) {
+        size_t visited = 0;
+        if (current == AdaptiveMode::Ordered) {
+            ordered.forEachInRange(lo, hi, [&](const Key& k, Value& v) {
+                ++visited;
+                fn(k, v);
+            });
+        } else {
+            // Neither Small nor Hashed keeps keys in order: filter, then sort.
+            // Keys are copied: flat_unordered_map<std::string, ...> hands out
+            // temporaries, not references into the table.
+            std::vector<std::pair<Key, Value*>> hits;
+            auto collect = [&](const Key& k, Value& v) {
+                if (!(k < lo) && k < hi) hits.emplace_back(k, &v);
+            };
+            forEach(collect);
+            std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto& [k, v] : hits) {
+                ++visited;
+                fn(static_cast<const Key&>(k), *v);
+            }
+        }
+        afterRangeQuery(visited);
+    }
+
+    // Visit every element, in key order only when Ordered.
+    template <class Fn>
+    void forEach(Fn&& fn) {
+        switch (current) {
+        case AdaptiveMode::Small:
+            for (auto& item : small) fn(static_cast<const Key&>(item.first), item.second);
+            break;
+        case AdaptiveMode::Hashed:
+            hashed.for_each(fn);
+            break;
+        case AdaptiveMode::Ordered:
+            ordered.forEach(fn);
+            break;
+        }
+    }
+
+    const Stats& stats() const { return totals; }
+    const std::deque<Decision>& decisions() const { return log; }
+
+    // One line per logged migration, oldest first.
+    void explain(std::FILE* out) const {
+        std::fprintf(out, "adaptive map: %s, %zu elements, %llu migrations moving %llu elements\n",
+                     adaptiveModeName(current), size(), static_cast<unsigned long long>(totals.migrations),
+                     static_cast<unsigned long long>(totals.elementsMoved));
+        for (auto const& d : log)
+            std::fprintf(out, "  %s -> %s (%s) at %zu elements after %llu point ops, %llu range queries, regret %.0f\n",
+                         adaptiveModeName(d.from), adaptiveModeName(d.to), reasonName(d.reason), d.size,
+                         static_cast<unsigned long long>(d.pointOps), static_cast<unsigned long long>(d.rangeQueries),
+                         d.regret);
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+// Allocation tracking for the benchmark builds. Replaces the global
+// operator new / delete with versions that forward to malloc / free and,
+// while tracking is enabled, count allocations, frees, requested bytes,
+// live and peak live bytes, and a histogram of requested sizes.
+//
+//   #define BENCH_TRACK_ALLOCATIONS      // in exactly one translation unit
+//   #include "alloc_tracker.hpp"
+//
+//   bench::alloc::Scope scope;          // enables tracking
+//   ... container operations ...
+//   bench::alloc::Stats s = scope.stop();
+//
+// Without BENCH_TRACK_ALLOCATIONS only the API is declared and
+// interposed() is false. Live bytes use malloc_usable_size on glibc, so
+// frees through unsized delete are accounted too; elsewhere only sized
+// deletes reduce the live count. Counters are relaxed atomics: totals are
+// exact across threads, the peak is approximate under contention.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace bench::alloc {
+
+// Requested-size buckets: <= 8, <= 16, ... <= 64 KiB, larger.
+inline constexpr int kBuckets = 15;
+
+inline size_t bucketLimit(int b) { return b + 1 < kBuckets ? size_t(8) << b : SIZE_MAX; }
+
+struct Stats {
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;             // requested
+    uint64_t peakLiveGrowth = 0;    // peak live bytes above the start of the scope
+    uint64_t hist[kBuckets] = {};
+};
+
+namespace detail {
+
+struct Counters {
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> allocs{0}, frees{0}, bytes{0};
+    std::atomic<int64_t> live{0}, peak{0};
+    std::atomic<uint64_t> hist[kBuckets] = {};
+};
+
+inline Counters counters;
+inline bool interposed = false;
+
+inline int bucketOf(size_t n) {
+    int b = 0;
+    for (size_t limit = 8; n > limit && b + 1 < kBuckets; limit <<= 1) ++b;
+    return b;
+}
+
+inline size_t usableSize(void* p, size_t requested) {
+#if defined(__GLIBC__)
+    (void)requested;
+    return malloc_usable_size(p);
+#else
+    (void)p;
+    return requested;
+#endif
+}
+
+inline void onAlloc(void* p, size_t n) {
+    Counters& c = counters;
+    if (!p || !c.enabled.load(std::memory_order_relaxed)) return;
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(n, std::memory_order_relaxed);
+    c.hist[bucketOf(n)].fetch_add(1, std::memory_order_relaxed);
+    int64_t size = static_cast<int64_t>(usableSize(p, n));
+    int64_t live = c.live.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = c.peak.load(std::memory_order_relaxed);
+    while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+// size 0: unknown (unsized delete)
+inline void onFree(void* p, size_t n) {
+    Counters& c = counters;
+    if (!p || !c.enabled.load(std::memory_order_relaxed)) return;
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+#if defined(__GLIBC__)
+    c.live.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+#else
+    if (n) c.live.fetch_sub(static_cast<int64_t>(n), std::memory_order_relaxed);
+#endif
+    (void)n;
+}
+
+inline void* allocate(size_t n) {
+    void* p = std::malloc(n ? n : 1);
+    onAlloc(p, n);
+    return p;
+}
+
+inline void* allocateAligned(size_t n, std::align_val_t al) {
+    size_t align = static_cast<size_t>(al);
+    void* p = std::aligned_alloc(align, (n + align - 1) / align * align);
+    onAlloc(p, n);
+    return p;
+}
+
+inline void release(void* p, size_t n) {
+    onFree(p, n);
+    std::free(p);
+}
+
+} // namespace detail
+
+// True when this program was built with BENCH_TRACK_ALLOCATIONS.
+inline bool interposed() { return detail::interposed; }
+
+// Tracks allocations made between construction and stop(), on any thread.
+// Scopes do not nest.
+class Scope {
+    Stats base;
+    int64_t liveAtStart = 0;
+    bool active = true;
+
+    static Stats read() {
+        detail::Counters& c = detail::counters;
+        Stats s;
+        s.allocs = c.allocs.load(std::memory_order_relaxed);
+        s.frees = c.frees.load(std::memory_order_relaxed);
+        s.bytes = c.bytes.load(std::memory_order_relaxed);
+        for (int b = 0; b < kBuckets; ++b) s.hist[b] = c.hist[b].load(std::memory_order_relaxed);
+        return s;
+    }
+
+public:
+    Scope() {
+        detail::Counters& c = detail::counters;
+        liveAtStart = c.live.load(std::memory_order_relaxed);
+        c.peak.store(liveAtStart, std::memory_order_relaxed);
+        base = read();
+        c.enabled.store(true, std::memory_order_relaxed);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope() {
+        if (active) stop();
+    }
+
+    Stats stop() {
+        detail::Counters& c = detail::counters;
+        c.enabled.store(false, std::memory_order_relaxed);
+        active = false;
+        Stats now = read();
+        Stats d;
+        d.allocs = now.allocs - base.allocs;
+        d.frees = now.frees - base.frees;
+        d.bytes = now.bytes - base.bytes;
+        for (int b = 0; b < kBuckets; ++b) d.hist[b] = now.hist[b] - base.hist[b];
+        int64_t peak = c.peak.load(std::memory_order_relaxed);
+        d.peakLiveGrowth = peak > liveAtStart ? static_cast<uint64_t>(peak - liveAtStart) : 0;
+        return d;
+    }
+};
+
+} // namespace bench::alloc
+
+#ifdef BENCH_TRACK_ALLOCATIONS
+
+namespace bench::alloc::detail {
+inline const bool kMarkInterposed = (interposed = true);
+}
+
+// Kept out of line: once inlined, GCC pairs the malloc / free inside with
+// the caller's new / delete and warns about mismatched deallocation.
+#if defined(__GNUC__)
+#define BENCH_ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_ALLOC_NOINLINE
+#endif
+
+BENCH_ALLOC_NOINLINE void* operator new(size_t n) {
+    if (void* p = bench::alloc::detail::allocate(n)) return p;
+    throw std::bad_alloc();
+}
+BENCH_ALLOC_NOINLINE void* operator new[](size_t n) {
+    if (void* p = bench::alloc::detail::allocate(n)) return p;
+    throw std::bad_alloc();
+}
+BENCH_ALLOC_NOINLINE void* operator new(size_t n, const std::nothrow_t&) noexcept { return bench::alloc::detail::allocate(n); }
+BENCH_ALLOC_NOINLINE void* operator new[](size_t n, const std::nothrow_t&) noexcept { return bench::alloc::detail::allocate(n); }
+BENCH_ALLOC_NOINLINE void* operator new(size_t n, std::align_val_t al) {
+    if (void* p = bench::alloc::detail::allocateAligned(n, al)) return p;
+    throw std::bad_alloc();
+}
+BENCH_ALLOC_NOINLINE void* operator new[](size_t n, std::align_val_t al) {
+    if (void* p = bench::alloc::detail::allocateAligned(n, al)) return p;
+    throw std::bad_alloc();
+}
+
+BENCH_ALLOC_NOINLINE void operator delete(void* p) noexcept { bench::alloc::detail::release(p, 0); }
+BENCH_ALLOC_NOINLINE void operator delete[](void* p) noexcept { bench::alloc::detail::release(p, 0); }
+BENCH_ALLOC_NOINLINE void operator delete(void* p, size_t n) noexcept { bench::alloc::detail::release(p, n); }
+BENCH_ALLOC_NOINLINE void operator delete[](void* p, size_t n) noexcept { bench::alloc::detail::release(p, n); }
+BENCH_ALLOC_NOINLINE void operator delete(void* p, std::align_val_t) noexcept { bench::alloc::detail::release(p, 0); }
+BENCH_ALLOC_NOINLINE void operator delete[](void* p, std::align_val_t) noexcept { bench::alloc::detail::release(p, 0); }
+BENCH_ALLOC_NOINLINE void operator delete(void* p, size_t n, std::align_val_t) noexcept { bench::alloc::detail::release(p, n); }
+BENCH_ALLOC_NOINLINE void operator delete[](void* p, size_t n, std::align_val_t) noexcept { bench::alloc::detail::release(p, n); }
+
+#endif
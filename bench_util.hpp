@@ -0,0 +1,208 @@
+#pragma once
+// Shared helpers for the benchmark programs: timing, memory usage,
+// hardware performance counters and key generators.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+// Keep the compiler from discarding a computed value.
+template <class T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+// Resident set size right now, 0 where unsupported.
+inline size_t currentRssBytes() {
+#if defined(__linux__)
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages = 0, resident = 0;
+    int got = std::fscanf(f, "%lu %lu", &pages, &resident);
+    std::fclose(f);
+    return got == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Bytes currently allocated from the heap (glibc), else resident set size.
+// Unlike RSS this drops when memory is freed, so deltas stay meaningful
+// across repeated runs in one process.
+inline size_t heapInUseBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return currentRssBytes();
+#endif
+}
+
+// Peak resident set size of the process so far, 0 where unsupported.
+inline size_t peakRssBytes() {
+#if defined(__linux__)
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return static_cast<size_t>(ru.ru_maxrss) * 1024;
+#else
+    return 0;
+#endif
+}
+
+// Hardware counters via perf_event_open, covering the constructing thread
+// and every thread started after construction (inherit), so pool workers
+// and DurableMap's writer and checkpoint threads are included. Threads that
+// already exist are not: construct before creating pools or maps that spawn
+// threads. Each event is opened on its own, so a PMU lacking one event
+// (dTLB on some VMs, say) still reports the others; available(c) tells
+// which opened. When the kernel multiplexes more events than the PMU has
+// counters, values are scaled by enabled / running time. Where perf is
+// unavailable (non-Linux, containers, perf_event_paranoid > 2) nothing
+// opens and stop() returns zeros with every valid flag false.
+class PerfCounters {
+public:
+    enum Counter { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses, DtlbMisses, kCount };
+
+    struct Values {
+        uint64_t value[kCount] = {};
+        bool valid[kCount] = {};
+
+        // < 0 when the counter is unavailable
+        double perOp(Counter c, size_t ops) const {
+            return valid[c] && ops ? static_cast<double>(value[c]) / static_cast<double>(ops) : -1.0;
+        }
+    };
+
+    static const char* name(Counter c) {
+        static const char* kNames[kCount] = {"cycles", "instr", "br-miss", "l1d-miss", "llc-miss", "dtlb-miss"};
+        return kNames[c];
+    }
+
+private:
+    int fds[kCount];
+
+#if defined(__linux__)
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static constexpr uint64_t cacheMiss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+
+public:
+    PerfCounters() {
+        for (int& fd : fds) fd = -1;
+#if defined(__linux__)
+        fds[Cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[Instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[BranchMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        fds[L1dMisses] = open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D));
+        fds[LlcMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds[DtlbMisses] = open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool available(Counter c) const { return fds[c] >= 0; }
+    bool available() const {
+        for (int fd : fds)
+            if (fd >= 0) return true;
+        return false;
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    Values stop() {
+        Values v;
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (int c = 0; c < kCount; ++c) {
+            if (fds[c] < 0) continue;
+            uint64_t data[3] = {};          // value, time enabled, time running
+            if (read(fds[c], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+            double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            v.value[c] = static_cast<uint64_t>(static_cast<double>(data[0]) * scale);
+            v.valid[c] = true;
+        }
+#endif
+        return v;
+    }
+};
+
+// 0, 1, 2, ... n-1
+inline std::vector<int> sequentialIds(size_t n) {
+    std::vector<int> ids(n);
+    std::iota(ids.begin(), ids.end(), 0);
+    return ids;
+}
+
+// n distinct non-negative ids spread over the int range, in random order.
+// i * odd constant is a bijection mod 2^31, so ids never collide.
+inline std::vector<int> randomIds(size_t n, uint64_t seed = 42) {
+    std::vector<int> ids(n);
+    for (size_t i = 0; i < n; ++i)
+        ids[i] = static_cast<int>((static_cast<uint32_t>(i) * 0x9E3779B1u) & 0x7fffffffu);
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(seed));
+    return ids;
+}
+
+} // namespace bench
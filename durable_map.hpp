@@ -0,0 +1,738 @@
+#pragma once
+// flat_unordered_map with a write-ahead log and checkpoints, so that its
+// contents survive restarts and crashes.
+//
+//   DurableMap<std::string, Account> accounts;
+//   if (!accounts.open("state/accounts")) ...      // recovers what is there
+//   accounts.insert_or_assign("alice", a);
+//   accounts.commit();                             // durable from here on
+//
+// insert_or_assign() and erase() apply the mutation to the in-memory map
+// and append an encoded record to a log buffer. A background thread writes
+// the buffer out once it holds `Options::groupBytes` or every
+// `Options::flushInterval`, and fdatasync()s at most every
+// `Options::syncInterval`, so one write and one sync cover many mutations
+// (group commit). The caller pays for the map operation plus a short copy
+// under an uncontended mutex. commit() waits until everything logged so
+// far is on disk. Without it, a crash loses at most the last
+// flushInterval + syncInterval of mutations. Recovery always yields a
+// prefix of the mutation history.
+//
+// The log is split into segments, wal-N.log. A checkpoint starts segment
+// N+1 and leaves the rest to a background thread, so the mutation that
+// triggers it pays only for the rotation and a thread start. That thread
+// waits until the earlier segments are on disk, rebuilds their contents
+// from the previous checkpoint and those segments (it never reads the live
+// map, but holds a second copy of the contents while it works), and writes
+// checkpoint-(N+1).bin: first to a temporary file, which is fsync'd and
+// renamed into place. Once the rename is durable, older checkpoints and
+// segments are deleted. Checkpoints are taken after every
+// `Options::checkpointBytes` of log, or on request.
+//
+// open() loads the newest checkpoint and replays the segments numbered
+// from it onward. Every record carries a checksum. Replay stops at the
+// first torn or corrupt record: its segment is truncated there and any
+// later segments are deleted. Appends then go to a new segment.
+//
+// Keys and values must be trivially copyable or std::string. A DurableMap
+// has a single writer. I/O errors are reported by open(), commit() and
+// healthy(). POSIX only.
+
+// Keep an includer's own SIMPLE_MAPS_NO_MAIN in effect after this block.
+#ifndef SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+#include "flat_buffered_unordered_map.cpp"
+#ifdef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#undef SIMPLE_MAPS_NO_MAIN
+#undef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace durable {
+
+template <class T>
+concept Encodable = std::is_trivially_copyable_v<T> || std::is_same_v<T, std::string>;
+
+enum class RecordOp : uint8_t { Put = 1, Erase = 2 };
+
+// Every record, in the log and in checkpoints:
+//   uint32 payload length, uint32 checksum of the payload, payload
+// payload: op, key, value (Put only). Strings are a uint32 length and the
+// bytes, anything else its object representation.
+struct RecordHeader {
+    uint32_t len;
+    uint32_t check;
+};
+
+inline uint32_t checksum(const char* p, size_t n) { return static_cast<uint32_t>(hashing::hashBytes(p, n)); }
+
+inline void putBytes(std::vector<char>& out, const void* p, size_t n) {
+    const char* c = static_cast<const char*>(p);
+    out.insert(out.end(), c, c + n);
+}
+
+template <class T>
+constexpr bool kIsString = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+template <class T>
+size_t encodedSize(const T& v) {
+    if constexpr (kIsString<T>) return sizeof(uint32_t) + v.size();
+    else return sizeof(T);
+}
+
+template <class T>
+char* put(char* p, const T& v) {
+    if constexpr (kIsString<T>) {
+        uint32_t n = static_cast<uint32_t>(v.size());
+        std::memcpy(p, &n, sizeof(n));
+        std::memcpy(p + sizeof(n), v.data(), v.size());
+        return p + sizeof(n) + v.size();
+    } else {
+        std::memcpy(p, &v, sizeof(T));
+        return p + sizeof(T);
+    }
+}
+
+template <class T>
+bool get(const char*& p, const char* end, T& v) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        uint32_t n;
+        if (end - p < static_cast<ptrdiff_t>(sizeof(n))) return false;
+        std::memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        if (static_cast<size_t>(end - p) < n) return false;
+        v.assign(p, n);
+        p += n;
+    } else {
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T))) return false;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+    }
+    return true;
+}
+
+// Append one record: op and fields. With `check` false the checksum is
+// left for fillChecksums(), so that it can be computed off the caller's
+// thread.
+template <class... Fields>
+void appendRecord(std::vector<char>& out, bool check, RecordOp op, const Fields&... fields) {
+    RecordHeader h;
+    h.len = static_cast<uint32_t>(1 + (encodedSize(fields) + ...));
+    size_t at = out.size();
+    out.resize(at + sizeof(h) + h.len);
+    char* payload = out.data() + at + sizeof(h);
+    char* p = payload;
+    *p++ = static_cast<char>(op);
+    ((p = put(p, fields)), ...);
+    h.check = check ? checksum(payload, h.len) : 0;
+    std::memcpy(out.data() + at, &h, sizeof(h));
+}
+
+inline void fillChecksums(std::vector<char>& records) {
+    for (size_t at = 0; at < records.size();) {
+        RecordHeader h;
+        std::memcpy(&h, records.data() + at, sizeof(h));
+        h.check = checksum(records.data() + at + sizeof(h), h.len);
+        std::memcpy(records.data() + at, &h, sizeof(h));
+        at += sizeof(h) + h.len;
+    }
+}
+
+// Length of the valid record at p, or 0 if it is short, torn or corrupt.
+inline size_t validRecord(const char* p, const char* end) {
+    RecordHeader h;
+    if (end - p < static_cast<ptrdiff_t>(sizeof(h))) return 0;
+    std::memcpy(&h, p, sizeof(h));
+    if (h.len == 0 || static_cast<size_t>(end - p) - sizeof(h) < h.len) return 0;
+    if (checksum(p + sizeof(h), h.len) != h.check) return 0;
+    return sizeof(h) + h.len;
+}
+
+inline bool writeAll(int fd, const char* p, size_t n) {
+    while (n) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+inline bool readFile(const std::string& path, std::vector<char>& out) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok) {
+        out.resize(static_cast<size_t>(st.st_size));
+        size_t got = 0;
+        while (ok && got < out.size()) {
+            ssize_t r = ::read(fd, out.data() + got, out.size() - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) ok = false;
+            else got += static_cast<size_t>(r);
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+// A rename or unlink is durable only once its directory is synced.
+inline bool syncDir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+inline std::string segmentPath(const std::string& dir, uint64_t n) { return dir + "/wal-" + std::to_string(n) + ".log"; }
+inline std::string checkpointPath(const std::string& dir, uint64_t n) { return dir + "/checkpoint-" + std::to_string(n) + ".bin"; }
+
+// "<prefix><number><suffix>" -> number
+inline bool parseNumbered(std::string_view name, std::string_view prefix, std::string_view suffix, uint64_t& n) {
+    if (name.size() <= prefix.size() + suffix.size() || !name.starts_with(prefix) || !name.ends_with(suffix)) return false;
+    const char* b = name.data() + prefix.size();
+    const char* e = name.data() + name.size() - suffix.size();
+    auto [ptr, ec] = std::from_chars(b, e, n);
+    return ec == std::errc() && ptr == e;
+}
+
+struct Options {
+    size_t groupBytes = 256 << 10;                      // write once this much is buffered
+    std::chrono::microseconds flushInterval{2000};      // and at least this often
+    std::chrono::microseconds syncInterval{10000};      // fdatasync at most this often; 0: after every write
+    uint64_t checkpointBytes = 64ull << 20;             // log bytes between checkpoints; 0: on request only
+};
+
+struct Stats {
+    uint64_t records = 0;           // appended since open()
+    uint64_t bytes = 0;             // appended since open()
+    uint64_t writes = 0;            // write batches
+    uint64_t syncs = 0;
+    uint64_t checkpoints = 0;       // completed since open()
+    uint64_t recovered = 0;         // log records replayed by open()
+    uint64_t segment = 0;           // segment being appended to
+};
+
+// The log segments and their writer thread. Positions are byte offsets in
+// the concatenation of all records appended since start().
+class Log {
+    struct Chunk {
+        uint64_t segment;
+        std::vector<char> bytes;
+    };
+
+    std::string dir_;
+    Options opts_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;          // writer: work to do
+    std::condition_variable durableCv_;     // commit(): durable_ advanced
+    std::vector<char> buf_;                 // records not yet handed to the writer
+    uint64_t bufSegment_ = 0;
+    std::deque<Chunk> sealed_;              // buffers of finished segments, oldest first
+    uint64_t appended_ = 0;
+    uint64_t records_ = 0;
+    uint64_t commitWanted_ = 0;
+    uint64_t durable_ = 0;
+    uint64_t writes_ = 0, syncs_ = 0;
+    bool stopping_ = false;
+    std::atomic<bool> failed_{false};
+
+    std::thread writer_;
+    int fd_ = -1;                           // writer thread only
+    uint64_t fdSegment_ = 0;
+
+    bool openSegment(uint64_t n) {
+        fd_ = ::open(segmentPath(dir_, n).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        fdSegment_ = n;
+        return fd_ >= 0 && syncDir(dir_);
+    }
+
+    // Segments are synced before the next one is written, so a crash can
+    // only tear the newest one.
+    bool writeChunk(uint64_t segment, std::vector<char>& bytes) {
+        if (segment != fdSegment_) {
+            bool ok = fd_ < 0 || ::fdatasync(fd_) == 0;
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+            if (!ok || !openSegment(segment)) return false;
+        }
+        fillChecksums(bytes);
+        return bytes.empty() || writeAll(fd_, bytes.data(), bytes.size());
+    }
+
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        std::vector<char> local;
+        std::deque<Chunk> chunks;
+        Clock::time_point lastSync = Clock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait_for(lock, opts_.flushInterval, [&] {
+                return stopping_ || buf_.size() >= opts_.groupBytes || !sealed_.empty() ||
+                       (commitWanted_ > durable_ && !failed_.load(std::memory_order_relaxed));
+            });
+            bool stop = stopping_;
+            bool commit = commitWanted_ > durable_;
+            chunks.swap(sealed_);
+            local.swap(buf_);
+            uint64_t segment = bufSegment_;
+            uint64_t upTo = appended_;
+            lock.unlock();
+
+            bool ok = !failed_.load(std::memory_order_relaxed);
+            bool wrote = !chunks.empty() || !local.empty();
+            for (Chunk& c : chunks) ok = ok && writeChunk(c.segment, c.bytes);
+            ok = ok && writeChunk(segment, local);
+            chunks.clear();
+            local.clear();
+
+            Clock::time_point now = Clock::now();
+            bool sync = upTo > durable_ && (commit || stop || now - lastSync >= opts_.syncInterval);
+            if (sync) {
+                ok = ok && ::fdatasync(fd_) == 0;
+                lastSync = now;
+            }
+            if (!ok) failed_.store(true, std::memory_order_relaxed);
+
+            // After a failure nothing more is durable: a later sync cannot
+            // vouch for records whose write was skipped or lost.
+            lock.lock();
+            writes_ += wrote;
+            if (sync) ++syncs_;
+            if (sync && ok) {
+                durable_ = upTo;
+                durableCv_.notify_all();
+            } else if (!ok) {
+                durableCv_.notify_all();
+            }
+            if (stop && sealed_.empty() && buf_.empty()) break;
+        }
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+public:
+    Log() = default;
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+    ~Log() { stop(); }
+
+    bool start(const std::string& dir, uint64_t segment, const Options& opts) {
+        dir_ = dir;
+        opts_ = opts;
+        bufSegment_ = segment;
+        buf_.clear();
+        sealed_.clear();
+        appended_ = records_ = commitWanted_ = durable_ = writes_ = syncs_ = 0;
+        buf_.reserve(opts_.groupBytes + (opts_.groupBytes >> 2));
+        failed_ = false;
+        stopping_ = false;
+        if (!openSegment(segment)) {
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        writer_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Flush, sync and stop the writer.
+    void stop() {
+        if (!writer_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+    }
+
+    // Append one record; returns the log position after it.
+    template <class... Fields>
+    uint64_t append(RecordOp op, const Fields&... fields) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t before = buf_.size();
+        appendRecord(buf_, false, op, fields...);
+        appended_ += buf_.size() - before;
+        ++records_;
+        uint64_t pos = appended_;
+        bool full = before < opts_.groupBytes && buf_.size() >= opts_.groupBytes;
+        lock.unlock();
+        if (full) wake_.notify_one();
+        return pos;
+    }
+
+    // Later appends go to the next segment; returns its number.
+    uint64_t rotate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sealed_.push_back({bufSegment_, std::move(buf_)});
+        buf_ = {};
+        buf_.reserve(opts_.groupBytes + (opts_.groupBytes >> 2));
+        wake_.notify_one();
+        return ++bufSegment_;
+    }
+
+    // Wait until everything appended so far, or up to log position `upTo`
+    // if that is earlier, is on disk.
+    bool commit(uint64_t upTo = UINT64_MAX) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = std::min(upTo, appended_);
+        if (target > commitWanted_) commitWanted_ = target;
+        wake_.notify_one();
+        durableCv_.wait(lock, [&] { return durable_ >= target || failed_.load(std::memory_order_relaxed); });
+        return durable_ >= target && !failed_.load(std::memory_order_relaxed);
+    }
+
+    bool healthy() const { return !failed_.load(std::memory_order_relaxed); }
+
+    void stats(Stats& s) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.records = records_;
+        s.bytes = appended_;
+        s.writes = writes_;
+        s.syncs = syncs_;
+        s.segment = bufSegment_;
+    }
+};
+
+} // namespace durable
+
+template <durable::Encodable Key, durable::Encodable Value, class Hash = hashing::Hash<Key>>
+class DurableMap {
+public:
+    using Map = flat_unordered_map<Key, Value, Hash>;
+    using Options = durable::Options;
+    using Stats = durable::Stats;
+
+private:
+    static constexpr char kCheckpointMagic[8] = {'S', 'M', 'A', 'P', 'C', 'K', 'P', '1'};
+
+    struct CheckpointHeader {
+        char magic[8];
+        uint64_t count;
+    };
+
+    Map map_;
+    durable::Log log_;
+    std::string dir_;
+    Options opts_;
+    bool open_ = false;
+
+    uint64_t checkpointAt_ = 0;             // log position of the last checkpoint
+    bool haveBase_ = false;                 // a checkpoint is on disk: checkpoint-<base_>.bin
+    uint64_t base_ = 0;                     // checkpointer thread, or with it joined
+    uint64_t recovered_ = 0;
+    std::thread checkpointer_;
+    std::atomic<bool> checkpointing_{false};
+    std::atomic<bool> checkpointFailed_{false};
+    std::atomic<uint64_t> checkpoints_{0};
+
+    // Apply one record's payload to `m`; false if it does not decode.
+    static bool apply(Map& m, const char* p, const char* end) {
+        if (p == end) return false;
+        auto op = static_cast<durable::RecordOp>(*p++);
+        Key k;
+        if (!durable::get(p, end, k)) return false;
+        if (op == durable::RecordOp::Erase) {
+            if (p != end) return false;
+            m.erase(k);
+            return true;
+        }
+        Value v;
+        if (op != durable::RecordOp::Put || !durable::get(p, end, v) || p != end) return false;
+        m.insert_or_assign(std::move(k), std::move(v));
+        return true;
+    }
+
+    static bool loadCheckpoint(Map& m, const std::string& path) {
+        std::vector<char> data;
+        if (!durable::readFile(path, data) || data.size() < sizeof(CheckpointHeader)) return false;
+        CheckpointHeader h;
+        std::memcpy(&h, data.data(), sizeof(h));
+        if (std::memcmp(h.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0) return false;
+        m.reserve(h.count);
+        const char* p = data.data() + sizeof(h);
+        const char* end = data.data() + data.size();
+        for (uint64_t i = 0; i < h.count; ++i) {
+            size_t n = durable::validRecord(p, end);
+            if (!n || !apply(m, p + sizeof(durable::RecordHeader), p + n)) return false;
+            p += n;
+        }
+        return p == end;
+    }
+
+    // Apply a segment's records to `m` up to the first torn or corrupt one.
+    // Returns the length of the valid prefix; `applied` counts the records.
+    static size_t applySegment(Map& m, const std::vector<char>& data, uint64_t& applied) {
+        const char* p = data.data();
+        const char* end = p + data.size();
+        while (p < end) {
+            size_t n = durable::validRecord(p, end);
+            if (!n || !apply(m, p + sizeof(durable::RecordHeader), p + n)) break;
+            p += n;
+            ++applied;
+        }
+        return static_cast<size_t>(p - data.data());
+    }
+
+    // Replay a segment, cutting off a torn or corrupt tail; `cut` tells
+    // whether anything was cut.
+    bool replay(const std::string& path, bool& cut) {
+        std::vector<char> data;
+        if (!durable::readFile(path, data)) return false;
+        size_t valid = applySegment(map_, data, recovered_);
+        cut = valid != data.size();
+        if (!cut) return true;
+        return ::truncate(path.c_str(), static_cast<off_t>(valid)) == 0;
+    }
+
+    // The contents as of the start of `segment`: the last checkpoint plus
+    // every segment before `segment`, which must all be on disk. Unlike
+    // open(), any bad record is an error.
+    bool rebuild(Map& m, uint64_t segment) const {
+        if (haveBase_ && !loadCheckpoint(m, durable::checkpointPath(dir_, base_))) return false;
+        std::vector<uint64_t> segments;
+        std::error_code ec;
+        for (auto const& entry : std::filesystem::directory_iterator(dir_, ec)) {
+            uint64_t n;
+            if (durable::parseNumbered(entry.path().filename().string(), "wal-", ".log", n) &&
+                (!haveBase_ || n >= base_) && n < segment)
+                segments.push_back(n);
+        }
+        if (ec) return false;
+        std::sort(segments.begin(), segments.end());
+        std::vector<char> data;
+        uint64_t applied = 0;
+        for (uint64_t s : segments)
+            if (!durable::readFile(durable::segmentPath(dir_, s), data) || applySegment(m, data, applied) != data.size())
+                return false;
+        return true;
+    }
+
+    static bool writeCheckpoint(const Map& snapshot, const std::string& tmp) {
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        std::vector<char> buf;
+        buf.reserve(1 << 20);
+        CheckpointHeader h;
+        std::memcpy(h.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+        h.count = snapshot.size();
+        durable::putBytes(buf, &h, sizeof(h));
+        bool ok = true;
+        snapshot.for_each([&](auto const& k, const Value& v) {
+            durable::appendRecord(buf, true, durable::RecordOp::Put, k, v);
+            if (buf.size() >= (1 << 20)) {
+                ok = ok && durable::writeAll(fd, buf.data(), buf.size());
+                buf.clear();
+            }
+        });
+        ok = ok && durable::writeAll(fd, buf.data(), buf.size()) && ::fsync(fd) == 0;
+        ok = ::close(fd) == 0 && ok;
+        return ok;
+    }
+
+    // Background half of checkpoint(): wait for the log up to `pos`, which
+    // ends the segments before `segment`; rebuild, write and publish the
+    // checkpoint, then drop what it supersedes.
+    void finishCheckpoint(uint64_t segment, uint64_t pos) {
+#if defined(__linux__)
+        // Yield to the mutating thread where they share a core.
+        ::setpriority(PRIO_PROCESS, static_cast<id_t>(::gettid()), 10);
+#endif
+        std::string path = durable::checkpointPath(dir_, segment);
+        std::string tmp = path + ".tmp";
+        bool ok = log_.commit(pos);
+        if (ok) {
+            Map snapshot;
+            ok = rebuild(snapshot, segment) && writeCheckpoint(snapshot, tmp) &&
+                 std::rename(tmp.c_str(), path.c_str()) == 0 && durable::syncDir(dir_);
+        }
+        if (ok) {
+            haveBase_ = true;
+            base_ = segment;
+            std::error_code ec;
+            for (auto const& entry : std::filesystem::directory_iterator(dir_, ec)) {
+                std::string name = entry.path().filename().string();
+                uint64_t n;
+                if ((durable::parseNumbered(name, "wal-", ".log", n) ||
+                     durable::parseNumbered(name, "checkpoint-", ".bin", n)) && n < segment)
+                    std::filesystem::remove(entry.path(), ec);
+            }
+            checkpoints_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ::unlink(tmp.c_str());
+            checkpointFailed_.store(true, std::memory_order_relaxed);
+        }
+        checkpointing_.store(false, std::memory_order_release);
+    }
+
+    void afterAppend(uint64_t pos) {
+        if (opts_.checkpointBytes && pos - checkpointAt_ >= opts_.checkpointBytes &&
+            !checkpointing_.load(std::memory_order_acquire))
+            startCheckpoint(pos);
+    }
+
+    bool startCheckpoint(uint64_t pos) {
+        if (!open_ || checkpointing_.load(std::memory_order_acquire)) return false;
+        if (checkpointer_.joinable()) checkpointer_.join();
+        uint64_t segment = log_.rotate();
+        checkpointAt_ = pos;
+        checkpointing_.store(true, std::memory_order_release);
+        checkpointer_ = std::thread([this, segment, pos] { finishCheckpoint(segment, pos); });
+        return true;
+    }
+
+public:
+    DurableMap() = default;
+    DurableMap(const DurableMap&) = delete;
+    DurableMap& operator=(const DurableMap&) = delete;
+    ~DurableMap() { close(); }
+
+    // Recover the contents stored under `dir` (created if missing) and start
+    // logging there. False on I/O errors or an unreadable checkpoint.
+    bool open(const std::string& dir, const Options& opts = Options()) {
+        close();
+        map_.clear();
+        dir_ = dir;
+        opts_ = opts;
+        recovered_ = 0;
+        checkpointAt_ = 0;
+        checkpointFailed_ = false;
+        checkpoints_ = 0;
+
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) return false;
+
+        std::vector<uint64_t> segments;
+        uint64_t newest = 0;
+        bool haveCheckpoint = false;
+        for (auto const& entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            uint64_t n;
+            if (name.ends_with(".tmp")) {
+                std::filesystem::remove(entry.path(), ec);
+            } else if (durable::parseNumbered(name, "wal-", ".log", n)) {
+                segments.push_back(n);
+            } else if (durable::parseNumbered(name, "checkpoint-", ".bin", n) && (!haveCheckpoint || n > newest)) {
+                newest = n;
+                haveCheckpoint = true;
+            }
+        }
+        if (ec) return false;
+        if (haveCheckpoint && !loadCheckpoint(map_, durable::checkpointPath(dir, newest))) return false;
+        haveBase_ = haveCheckpoint;
+        base_ = newest;
+
+        // Segments after a cut one continue a history that was lost at the
+        // cut; replaying them would not give a prefix of it, so they go.
+        std::sort(segments.begin(), segments.end());
+        uint64_t next = newest;
+        bool cut = false;
+        for (uint64_t s : segments) {
+            if (s < newest) continue;
+            if (cut) {
+                if (::unlink(durable::segmentPath(dir, s).c_str()) != 0) return false;
+                continue;
+            }
+            next = s + 1;
+            if (!replay(durable::segmentPath(dir, s), cut)) return false;
+        }
+        if (cut && !durable::syncDir(dir)) return false;
+        if (!log_.start(dir, next, opts_)) return false;
+        open_ = true;
+        return true;
+    }
+
+    // Wait for a running checkpoint, flush and sync the log, stop logging.
+    // The map keeps its contents.
+    void close() {
+        if (checkpointer_.joinable()) checkpointer_.join();
+        log_.stop();
+        open_ = false;
+    }
+
+    // Insert or assign and log it; true if the key was new.
+    std::pair<bool, const Value*> insert_or_assign(const Key& k, const Value& v) {
+        auto [inserted, p] = map_.insert_or_assign(k, v);
+        if (open_) afterAppend(log_.append(durable::RecordOp::Put, k, v));
+        return {inserted, p};
+    }
+
+    // Erase and log it; true if erased. Erasing an absent key is not logged.
+    bool erase(const Key& k) {
+        if (!map_.erase(k)) return false;
+        if (open_) afterAppend(log_.append(durable::RecordOp::Erase, k));
+        return true;
+    }
+
+    const Value* find(const Key& k) const { return map_.find(k); }
+    size_t size() const { return map_.size(); }
+    bool empty() const { return map_.empty(); }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const { map_.for_each(std::forward<Fn>(fn)); }
+
+    // Read-only; mutations must go through the DurableMap to be logged.
+    const Map& map() const { return map_; }
+
+    // Block until every mutation so far is on disk. Concurrent writes and
+    // syncs are shared, so committing often costs a sync per batch, not per
+    // mutation. False if the log has hit an I/O error.
+    bool commit() { return open_ && log_.commit(); }
+
+    // Start a checkpoint in the background; false if one is still running.
+    bool checkpoint() {
+        durable::Stats s;
+        log_.stats(s);
+        return startCheckpoint(s.bytes);
+    }
+
+    void waitForCheckpoint() {
+        if (checkpointer_.joinable()) checkpointer_.join();
+    }
+
+    // False once a log write, sync or checkpoint has failed.
+    bool healthy() const { return log_.healthy() && !checkpointFailed_.load(std::memory_order_relaxed); }
+
+    Stats stats() {
+        Stats s;
+        log_.stats(s);
+        s.checkpoints = checkpoints_.load(std::memory_order_relaxed);
+        s.recovered = recovered_;
+        return s;
+    }
+};
@@ -0,0 +1,290 @@
+// Scaling benchmark for EntityManager.
+//
+//   g++ -std=c++20 -O2 -pthread entity_manager_bench.cpp -o entity_manager_bench
+//   ./entity_manager_bench [n ...]          (default: 10000 100000 1000000)
+//
+// For each entity count and id pattern it measures add, lookup (hit, miss,
+// batched), full iteration and removal in random, FIFO and LIFO order, for
+// both vector and chunked storage, then compares id -> index structures on
+// their own. Reports ns/op, memory per entity (heap growth while adding) and,
+// where perf counters are available, cycles, instructions, branch misses and
+// L1D / LLC / dTLB misses per op. The SIMD range and integer hash kernels
+// are timed at every level the CPU supports; the header names the level
+// dispatch picked.
+
+#define SIMPLE_MAPS_NO_MAIN
+#include "vector_with_index_map.cpp"
+#include "flat_buffered_unordered_map.cpp"
+#undef SIMPLE_MAPS_NO_MAIN
+
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+namespace {
+
+bench::PerfCounters counters;
+
+struct Row {
+    const char* container;
+    const char* op;
+    const char* ids;
+    size_t n;
+    double nsPerOp;
+    double bytesPerEntity;  // < 0 when not measured
+    bench::PerfCounters::Values counts;
+};
+
+void printHeader() {
+    std::printf("%-10s %-14s %-6s %10s %10s %9s %13s", "storage", "op", "ids", "n", "ns/op", "Mops/s",
+                "bytes/entity");
+    for (int c = 0; c < bench::PerfCounters::kCount; ++c)
+        std::printf(" %9s", bench::PerfCounters::name(static_cast<bench::PerfCounters::Counter>(c)));
+    std::printf("\n");
+}
+
+// Counter columns are per op; n/a where the counter could not be opened.
+void printRow(const Row& r) {
+    std::printf("%-10s %-14s %-6s %10zu %10.1f %9.2f ", r.container, r.op, r.ids, r.n,
+                r.nsPerOp, r.nsPerOp > 0 ? 1e3 / r.nsPerOp : 0.0);
+    if (r.bytesPerEntity >= 0) std::printf("%13.1f", r.bytesPerEntity);
+    else std::printf("%13s", "-");
+    for (int c = 0; c < bench::PerfCounters::kCount; ++c) {
+        double v = r.counts.perOp(static_cast<bench::PerfCounters::Counter>(c), r.n);
+        if (v >= 0) std::printf(" %9.2f", v);
+        else std::printf(" %9s", "n/a");
+    }
+    std::printf("\n");
+}
+
+// Time `body` (which performs `ops` operations) and print one row. With
+// `footprint`, heap growth across the body is reported per op as well.
+template <class Fn>
+void measure(const char* container, const char* op, const char* ids, size_t ops, Fn&& body,
+             bool footprint = false) {
+    size_t heap0 = footprint ? bench::heapInUseBytes() : 0;
+    counters.start();
+    uint64_t t0 = bench::nowNs();
+    body();
+    uint64_t t1 = bench::nowNs();
+    bench::PerfCounters::Values counts = counters.stop();
+    size_t heap1 = footprint ? bench::heapInUseBytes() : 0;
+
+    double perOp = ops ? static_cast<double>(t1 - t0) / static_cast<double>(ops) : 0.0;
+    double bytes = footprint && ops && heap1 >= heap0
+        ? static_cast<double>(heap1 - heap0) / static_cast<double>(ops) : -1.0;
+    printRow({container, op, ids, ops, perOp, bytes, counts});
+}
+
+template <class Manager>
+void fill(Manager& mgr, const std::vector<int>& ids) {
+    static const char* kNames[] = {"Orc", "Elf", "Dwarf", "Goblin", "Troll", "Imp", "Human", "Ogre"};
+    for (size_t i = 0; i < ids.size(); ++i)
+        mgr.tryAddEntity(ids[i], kNames[i & 7], static_cast<float>(i % 200));
+}
+
+template <class Manager>
+void benchManager(const char* container, const std::vector<int>& ids, const char* pattern) {
+    const size_t n = ids.size();
+
+    // add, with the memory footprint of the finished manager
+    {
+        Manager mgr;
+        measure(container, "add", pattern, n, [&] { fill(mgr, ids); }, true);
+
+        std::vector<int> probe = ids;
+        std::shuffle(probe.begin(), probe.end(), std::mt19937_64(7));
+
+        measure(container, "get-hit", pattern, n, [&] {
+            float sum = 0;
+            for (int id : probe) sum += mgr.getEntity(id)->health;
+            bench::doNotOptimize(sum);
+        });
+
+        std::vector<int> absent(n);
+        for (size_t i = 0; i < n; ++i) absent[i] = -1 - static_cast<int>(i);
+        measure(container, "get-miss", pattern, n, [&] {
+            size_t found = 0;
+            for (int id : absent) found += mgr.getEntity(id) != nullptr;
+            bench::doNotOptimize(found);
+        });
+
+        std::vector<float> out(n);
+        measure(container, "get-batch", pattern, n, [&] {
+            mgr.gatherHealth(probe, out);
+            bench::doNotOptimize(out.data());
+        });
+
+        measure(container, "iterate", pattern, n, [&] {
+            float sum = 0;
+            for (size_t i = 0; i < mgr.size(); ++i) sum += mgr.entityAt(i).health;
+            bench::doNotOptimize(sum);
+        });
+    }
+
+    // bulk add
+    {
+        Manager mgr;
+        std::vector<typename Manager::Spawn> spawns(n);
+        for (size_t i = 0; i < n; ++i) spawns[i] = {ids[i], "Orc", 100.f};
+        std::vector<typename Manager::AddStatus> status(n);
+        measure(container, "add-bulk", pattern, n, [&] { mgr.addEntities(spawns, status); });
+
+        // The same spawns in waves of 100, as a spawner calling once per tick.
+        Manager waves;
+        constexpr size_t kWave = 100;
+        measure(container, "add-waves", pattern, n, [&] {
+            for (size_t i = 0; i < n; i += kWave) {
+                size_t len = std::min(kWave, n - i);
+                waves.addEntities(std::span(spawns).subspan(i, len), std::span(status).subspan(i, len));
+            }
+        });
+    }
+
+    // removal patterns, each on a fresh manager
+    auto removeAll = [&](const char* op, std::vector<int> order) {
+        Manager mgr;
+        fill(mgr, ids);
+        measure(container, op, pattern, n, [&] {
+            for (int id : order) mgr.removeEntity(id);
+        });
+    };
+    std::vector<int> order = ids;
+    removeAll("remove-fifo", order);
+    std::reverse(order.begin(), order.end());
+    removeAll("remove-lifo", order);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(11));
+    removeAll("remove-random", order);
+}
+
+// id -> dense index structures on their own: insert all ids, then look
+// each one up in random order.
+template <class Insert, class Find>
+void benchIndex(const char* name, const std::vector<int>& ids, const char* pattern,
+                Insert&& insert, Find&& find) {
+    const size_t n = ids.size();
+    measure(name, "index-insert", pattern, n, [&] {
+        for (size_t i = 0; i < n; ++i) insert(ids[i], i);
+    }, true);
+
+    std::vector<int> probe = ids;
+    std::shuffle(probe.begin(), probe.end(), std::mt19937_64(3));
+    measure(name, "index-find", pattern, n, [&] {
+        size_t sum = 0;
+        for (int id : probe) sum += find(id);
+        bench::doNotOptimize(sum);
+    });
+}
+
+void benchIndexes(const std::vector<int>& ids, const char* pattern) {
+    const size_t n = ids.size();
+    {
+        std::unordered_map<int, size_t> m;
+        benchIndex("unordered", ids, pattern,
+                   [&](int id, size_t i) { m.emplace(id, i); },
+                   [&](int id) { return m.find(id)->second; });
+    }
+    {
+        std::unordered_map<int, size_t> m;
+        m.reserve(n);
+        benchIndex("unord+rsv", ids, pattern,
+                   [&](int id, size_t i) { m.emplace(id, i); },
+                   [&](int id) { return m.find(id)->second; });
+    }
+    {
+        flat_unordered_map<int, size_t> m;
+        benchIndex("flat", ids, pattern,
+                   [&](int id, size_t i) { m.insert_or_assign(id, i); },
+                   [&](int id) { return *m.find(id); });
+
+        std::vector<int> probe = ids;
+        std::shuffle(probe.begin(), probe.end(), std::mt19937_64(3));
+        std::vector<size_t*> out(n);
+        measure("flat", "index-batch", pattern, n, [&] {
+            bench::doNotOptimize(m.find_many(probe, out));
+        });
+    }
+    {
+        // Sorted (id, index) array: built by one sort, found by binary search.
+        std::vector<std::pair<int, size_t>> v;
+        bool sorted = false;
+        benchIndex("sorted", ids, pattern,
+                   [&](int id, size_t i) {
+                       if (v.empty()) v.reserve(n);
+                       v.push_back({id, i});
+                       if (v.size() == n) {
+                           std::sort(v.begin(), v.end());
+                           sorted = true;
+                       }
+                   },
+                   [&](int id) {
+                       auto it = std::lower_bound(v.begin(), v.end(), std::make_pair(id, size_t(0)));
+                       return sorted ? it->second : 0;
+                   });
+    }
+    if (!ids.empty() && static_cast<size_t>(*std::max_element(ids.begin(), ids.end())) < 4 * n) {
+        // Direct sparse array, only sensible for dense id ranges.
+        std::vector<uint32_t> direct;
+        benchIndex("direct", ids, pattern,
+                   [&](int id, size_t i) {
+                       if (direct.size() <= static_cast<size_t>(id)) direct.resize(static_cast<size_t>(id) + 1, UINT32_MAX);
+                       direct[static_cast<size_t>(id)] = static_cast<uint32_t>(i);
+                   },
+                   [&](int id) { return static_cast<size_t>(direct[static_cast<size_t>(id)]); });
+    }
+}
+
+// The SIMD range kernels on a health-like column and the batch integer
+// hash, once per level this CPU supports, so the dispatched path can be
+// compared with the others.
+void benchKernels(size_t n) {
+    std::vector<float> values(n);
+    std::mt19937_64 rng(5);
+    for (float& v : values) v = static_cast<float>(rng() % 20000) / 100.f;
+    std::vector<uint32_t> out(n);
+    std::vector<int> ids = bench::randomIds(n);
+    std::vector<uint64_t> hashes(n);
+    for (int l = 0; l <= static_cast<int>(simd::detectedLevel()); ++l) {
+        simd::Kernels k = simd::kernelsFor(static_cast<simd::Level>(l));
+        const char* name = simd::levelName(k.level);
+        measure(name, "count-range", "-", n, [&] {
+            bench::doNotOptimize(k.countInRange(values.data(), n, 10.f, 90.f));
+        });
+        measure(name, "select-range", "-", n, [&] {
+            bench::doNotOptimize(k.selectInRange(values.data(), n, 10.f, 90.f, out.data()));
+        });
+        hashing::Kernels h = hashing::kernelsFor(static_cast<simd::Level>(l));
+        measure(name, "hash-int32", "random", n, [&] {
+            h.ints32(ids.data(), n, hashes.data());
+            bench::doNotOptimize(hashes[n - 1]);
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {10000, 100000, 1000000};
+
+    std::printf("perf counters:");
+    if (!counters.available()) std::printf(" unavailable");
+    for (int c = 0; c < bench::PerfCounters::kCount; ++c)
+        if (counters.available(static_cast<bench::PerfCounters::Counter>(c)))
+            std::printf(" %s", bench::PerfCounters::name(static_cast<bench::PerfCounters::Counter>(c)));
+    std::printf("\n");
+    std::printf("simd: %s (detected %s)\n", simd::levelName(simd::activeLevel()),
+                simd::levelName(simd::detectedLevel()));
+    printHeader();
+    for (size_t n : sizes) {
+        auto seq = bench::sequentialIds(n);
+        auto rnd = bench::randomIds(n);
+        for (auto [ids, pattern] : {std::pair{&seq, "seq"}, std::pair{&rnd, "random"}}) {
+            benchManager<EntityManager>("vector", *ids, pattern);
+            benchManager<ChunkedEntityManager>("chunked", *ids, pattern);
+            benchIndexes(*ids, pattern);
+        }
+        benchKernels(n);
+    }
+}
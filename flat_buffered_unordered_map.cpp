@@ -1,14 +1,25 @@
+#ifndef SIMPLE_MAPS_FLAT_MAP_CPP
+#define SIMPLE_MAPS_FLAT_MAP_CPP
+
 #include <vector>
+#include <algorithm>
 #include <functional>
+#include <span>
 #include <utility>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
 
+#include "hashing.hpp"
+
 template<
     class Key,
     class T,
-    class Hash = std::hash<Key>,
+    class Hash = hashing::Hash<Key>,
     class KeyEq = std::equal_to<Key>
 >
 class flat_unordered_map {
@@ -50,6 +61,17 @@ private:
         return hasher_(k) & mask(); // requires capacity power-of-two
     }
 
+    // probe from the home bucket of hash h (buckets_ must not be empty)
+    T* find_hashed(const Key& k, size_t h) {
+        size_type idx = h & mask();
+        for (;;) {
+            Bucket& b = buckets_[idx];
+            if (b.state == State::Empty) return nullptr; // stop on Empty
+            if (b.state == State::Filled && keyeq_(b.key, k)) return &b.value;
+            idx = (idx + 1) & mask();
+        }
+    }
+
     float current_load() const {
         return static_cast<float>(size_ + tombstones_) / static_cast<float>(buckets_.size());
     }
@@ -135,13 +157,7 @@ public:
     // find -> pointer to value (nullptr if not found)
     T* find(const Key& k) {
         if (buckets_.empty()) return nullptr;
-        size_type idx = bucket_index(k);
-        for (;;) {
-            Bucket& b = buckets_[idx];
-            if (b.state == State::Empty) return nullptr; // stop on Empty
-            if (b.state == State::Filled && keyeq_(b.key, k)) return &b.value;
-            idx = (idx + 1) & mask();
-        }
+        return find_hashed(k, hasher_(k));
     }
 
     const T* find(const Key& k) const {
@@ -155,6 +171,39 @@ public:
         }
     }
 
+    static constexpr size_type kFindBatch = 16;
+
+    // Look up many keys at once: out[i] = find(keys[i]). Keys are hashed a
+    // group at a time through the hasher's batch form when it has one
+    // (hashing::Hash does, vectorised for integers), and each group's home
+    // buckets are prefetched before any is probed, so their misses overlap.
+    // Returns the number found; `out` must be at least as long as `keys`.
+    size_type find_many(std::span<const Key> keys, std::span<T*> out) {
+        if (buckets_.empty()) {
+            std::fill_n(out.begin(), keys.size(), nullptr);
+            return 0;
+        }
+        uint64_t hashes[kFindBatch];
+        size_type found = 0;
+        for (size_type base = 0; base < keys.size(); base += kFindBatch) {
+            size_type n = std::min(kFindBatch, keys.size() - base);
+            const Key* group = keys.data() + base;
+            if constexpr (requires { hasher_.many(group, n, hashes); }) {
+                hasher_.many(group, n, hashes);
+            } else {
+                for (size_type j = 0; j < n; ++j) hashes[j] = hasher_(group[j]);
+            }
+#if defined(__GNUC__) || defined(__clang__)
+            for (size_type j = 0; j < n; ++j) __builtin_prefetch(&buckets_[hashes[j] & mask()]);
+#endif
+            for (size_type j = 0; j < n; ++j) {
+                out[base + j] = find_hashed(group[j], static_cast<size_t>(hashes[j]));
+                found += out[base + j] != nullptr;
+            }
+        }
+        return found;
+    }
+
     // operator[] inserts default if missing
     T& operator[](const Key& k) {
         if (auto* p = find(k)) return *p;
@@ -196,6 +245,19 @@ public:
         tombstones_ = 0;
     }
 
+    // visit every element: fn(const Key&, T&)
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        for (auto& b : buckets_)
+            if (b.state == State::Filled) fn(static_cast<const Key&>(b.key), b.value);
+    }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (auto const& b : buckets_)
+            if (b.state == State::Filled) fn(b.key, b.value);
+    }
+
     size_type size() const { return size_; }
     bool empty() const { return size_ == 0; }
     size_type bucket_count() const { return buckets_.size(); }
@@ -215,10 +277,332 @@ public:
     float max_load_factor() const { return max_load_factor_; }
 };
 
+// std::string keys: no std::string in the slots. Each slot holds the key
+// length, 16 hash bits and 16 inline bytes: the whole key when it is at most
+// 16 bytes, else its first 8 bytes and the offset of the full key in a
+// per-table arena. A probe compares length, hash bits and the inline bytes
+// before anything else, so a mismatching slot is rejected without leaving
+// the slot array, and short keys never leave it at all. The arena is
+// compacted on every rehash.
+//
+// find() also takes anything convertible to std::string_view; erase and
+// operator[] take std::string_view. for_each passes the key as
+// std::string_view to callbacks that accept one, otherwise as a temporary
+// std::string. Keys compare bytewise, so this applies only with the default
+// KeyEq. Hash must accept std::string_view (hashing::Hash does;
+// std::hash<std::string> is mapped to std::hash<std::string_view>).
+template <class T, class Hash>
+class flat_unordered_map<std::string, T, Hash, std::equal_to<std::string>> {
+public:
+    using key_type        = std::string;
+    using mapped_type     = T;
+    using value_type      = std::pair<const std::string, T>;
+    using size_type       = std::size_t;
+
+    static constexpr size_type kInlineKey = 16;
+
+private:
+    enum class State : uint8_t { Empty, Filled, Deleted };
+
+    struct Bucket {
+        alignas(8) char bytes[kInlineKey] = {};  // key, or 8-byte prefix + arena offset
+        uint32_t len = 0;
+        uint16_t tag = 0;
+        State    state = State::Empty;
+        T        value{};
+    };
+
+    // A key prepared once per lookup: its inline form and hash.
+    struct KeyRef {
+        std::string_view s;
+        alignas(8) char bytes[kInlineKey] = {};
+        size_t hash;
+        uint16_t tag;
+    };
+
+    std::vector<Bucket> buckets_;
+    std::vector<char>   arena_;              // full bytes of keys over kInlineKey
+    size_type           arena_garbage_ = 0;  // bytes of erased keys in arena_
+    size_type           size_ = 0;
+    size_type           tombstones_ = 0;
+    float               max_load_factor_ = 0.7f;
+
+    Hash hasher_;
+
+    static size_type next_pow2(size_type x) {
+        if (x < 2) return 2;
+        --x;
+        for (size_type i = 1; i < sizeof(size_type) * 8; i <<= 1) x |= x >> i;
+        return x + 1;
+    }
+
+    size_type mask() const { return buckets_.size() - 1; }
+
+    float current_load() const {
+        return static_cast<float>(size_ + tombstones_) / static_cast<float>(buckets_.size());
+    }
+
+    // Probes hash the borrowed bytes; a hasher that needs a std::string
+    // would allocate one per probe. std::hash<std::string> is served by
+    // std::hash<std::string_view>, which the standard makes equal to it.
+    size_t hash_of(std::string_view s) const {
+        if constexpr (std::is_same_v<Hash, std::hash<std::string>>) {
+            return std::hash<std::string_view>{}(s);
+        } else {
+            static_assert(std::is_invocable_r_v<size_t, const Hash&, std::string_view>,
+                          "flat_unordered_map<std::string, ...>: Hash must accept std::string_view");
+            return hasher_(s);
+        }
+    }
+
+    static KeyRef make_ref(std::string_view s, size_t h) {
+        KeyRef r;
+        r.s = s;
+        r.hash = h;
+        r.tag = static_cast<uint16_t>(static_cast<uint64_t>(h) >> 48);
+        std::memcpy(r.bytes, s.data(), std::min(s.size(), s.size() <= kInlineKey ? kInlineKey : size_type(8)));
+        return r;
+    }
+
+    static uint64_t word(const char* p) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        return w;
+    }
+
+    static uint64_t arena_offset(const Bucket& b) { return word(b.bytes + 8); }
+
+    static std::string_view key_of(const Bucket& b, const std::vector<char>& arena) {
+        if (b.len <= kInlineKey) return {b.bytes, b.len};
+        return {arena.data() + arena_offset(b), b.len};
+    }
+
+    bool matches(const Bucket& b, const KeyRef& r) const {
+        if (b.len != r.s.size() || b.tag != r.tag || word(b.bytes) != word(r.bytes)) return false;
+        if (b.len <= kInlineKey) return word(b.bytes + 8) == word(r.bytes + 8);
+        return std::memcmp(arena_.data() + arena_offset(b) + 8, r.s.data() + 8, b.len - 8) == 0;
+    }
+
+    void store_key(Bucket& b, const KeyRef& r) {
+        b.len = static_cast<uint32_t>(r.s.size());
+        b.tag = r.tag;
+        std::memcpy(b.bytes, r.bytes, kInlineKey);
+        if (b.len > kInlineKey) {
+            uint64_t off = arena_.size();
+            arena_.insert(arena_.end(), r.s.begin(), r.s.end());
+            std::memcpy(b.bytes + 8, &off, 8);
+        }
+    }
+
+    void rehash_if_needed() {
+        if (buckets_.empty() || current_load() > max_load_factor_) {
+            size_type new_cap = buckets_.empty() ? 16 : buckets_.size() * 2;
+            rehash(new_cap);
+        }
+    }
+
+    Bucket* find_ref(const KeyRef& r) {
+        size_type idx = r.hash & mask();
+        for (;;) {
+            Bucket& b = buckets_[idx];
+            if (b.state == State::Empty) return nullptr;
+            if (b.state == State::Filled && matches(b, r)) return &b;
+            idx = (idx + 1) & mask();
+        }
+    }
+
+    template <class V>
+    std::pair<size_type, bool> insert_or_assign_impl(std::string_view k, V&& v) {
+        rehash_if_needed();
+
+        KeyRef r = make_ref(k, hash_of(k));
+        size_type idx = r.hash & mask();
+        size_type first_deleted = static_cast<size_type>(-1);
+
+        for (;;) {
+            Bucket& b = buckets_[idx];
+            if (b.state == State::Empty) {
+                size_type target = (first_deleted == static_cast<size_type>(-1)) ? idx : first_deleted;
+                Bucket& t = buckets_[target];
+
+                if (t.state == State::Deleted) tombstones_--;
+                store_key(t, r);
+                t.value = std::forward<V>(v);
+                t.state = State::Filled;
+                size_++;
+                return {target, true};
+            } else if (b.state == State::Deleted) {
+                if (first_deleted == static_cast<size_type>(-1)) first_deleted = idx;
+            } else if (matches(b, r)) {
+                b.value = std::forward<V>(v);
+                return {idx, false};
+            }
+            idx = (idx + 1) & mask();
+        }
+    }
+
+    T* find_view(std::string_view k) {
+        if (buckets_.empty()) return nullptr;
+        Bucket* b = find_ref(make_ref(k, hash_of(k)));
+        return b ? &b->value : nullptr;
+    }
+
+    template <class Fn, class B>
+    static void visit(Fn& fn, B& b, const std::vector<char>& arena) {
+        std::string_view k = key_of(b, arena);
+        if constexpr (std::is_invocable_v<Fn&, std::string_view, decltype((b.value))>) fn(k, b.value);
+        else fn(static_cast<const std::string&>(std::string(k)), b.value);
+    }
+
+public:
+    flat_unordered_map() = default;
+
+    explicit flat_unordered_map(size_type bucket_count,
+                                const Hash& h = Hash(),
+                                const std::equal_to<std::string>& = {})
+        : hasher_(h) {
+        buckets_.resize(next_pow2(bucket_count));
+    }
+
+    // Also compacts the key arena.
+    void rehash(size_type new_bucket_count) {
+        new_bucket_count = next_pow2(new_bucket_count);
+        if (new_bucket_count < 2) new_bucket_count = 2;
+
+        std::vector<Bucket> old = std::move(buckets_);
+        std::vector<char> old_arena = std::move(arena_);
+        buckets_.assign(new_bucket_count, Bucket{});
+        arena_.clear();
+        arena_.reserve(old_arena.size() - arena_garbage_);
+        arena_garbage_ = 0;
+        size_ = 0;
+        tombstones_ = 0;
+
+        for (auto& b : old)
+            if (b.state == State::Filled) insert_or_assign_impl(key_of(b, old_arena), std::move(b.value));
+    }
+
+    std::pair<bool, T*> insert_or_assign(const std::string& k, const T& v) {
+        auto [pos, inserted] = insert_or_assign_impl(k, v);
+        return {inserted, &buckets_[pos].value};
+    }
+    std::pair<bool, T*> insert_or_assign(std::string&& k, T&& v) {
+        auto [pos, inserted] = insert_or_assign_impl(k, std::move(v));
+        return {inserted, &buckets_[pos].value};
+    }
+
+    T* find(const key_type& k) { return find_view(k); }
+    const T* find(const key_type& k) const { return const_cast<flat_unordered_map*>(this)->find_view(k); }
+
+    // Heterogeneous lookup: string_view, const char*, ...
+    template <class K>
+        requires (std::is_convertible_v<const K&, std::string_view> && !std::is_same_v<K, key_type>)
+    T* find(const K& k) { return find_view(k); }
+
+    template <class K>
+        requires (std::is_convertible_v<const K&, std::string_view> && !std::is_same_v<K, key_type>)
+    const T* find(const K& k) const { return const_cast<flat_unordered_map*>(this)->find_view(k); }
+
+    static constexpr size_type kFindBatch = 16;
+
+    // As in the primary template: hashed a group at a time, home buckets
+    // prefetched before probing.
+    size_type find_many(std::span<const std::string> keys, std::span<T*> out) {
+        if (buckets_.empty()) {
+            std::fill_n(out.begin(), keys.size(), nullptr);
+            return 0;
+        }
+        uint64_t hashes[kFindBatch];
+        size_type found = 0;
+        for (size_type base = 0; base < keys.size(); base += kFindBatch) {
+            size_type n = std::min(kFindBatch, keys.size() - base);
+            const std::string* group = keys.data() + base;
+            if constexpr (requires { hasher_.many(group, n, hashes); }) {
+                hasher_.many(group, n, hashes);
+            } else {
+                for (size_type j = 0; j < n; ++j) hashes[j] = hash_of(group[j]);
+            }
+#if defined(__GNUC__) || defined(__clang__)
+            for (size_type j = 0; j < n; ++j) __builtin_prefetch(&buckets_[hashes[j] & mask()]);
+#endif
+            for (size_type j = 0; j < n; ++j) {
+                Bucket* b = find_ref(make_ref(group[j], static_cast<size_t>(hashes[j])));
+                out[base + j] = b ? &b->value : nullptr;
+                found += b != nullptr;
+            }
+        }
+        return found;
+    }
+
+    // operator[] inserts default if missing
+    T& operator[](std::string_view k) {
+        if (auto* p = find_view(k)) return *p;
+        auto [pos, inserted] = insert_or_assign_impl(k, T{});
+        (void)inserted;
+        return buckets_[pos].value;
+    }
+
+    // erase -> true if erased
+    bool erase(std::string_view k) {
+        if (buckets_.empty()) return false;
+        Bucket* b = find_ref(make_ref(k, hash_of(k)));
+        if (!b) return false;
+        b->state = State::Deleted;
+        if (b->len > kInlineKey) arena_garbage_ += b->len;
+        size_--;
+        tombstones_++;
+        if (tombstones_ > buckets_.size() / 2 || arena_garbage_ > arena_.size() / 2 + 4096)
+            rehash(buckets_.size());
+        return true;
+    }
+
+    void clear() {
+        for (auto& b : buckets_) b.state = State::Empty;
+        arena_.clear();
+        arena_garbage_ = 0;
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    // visit every element: fn(std::string_view or const std::string&, T&)
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        for (auto& b : buckets_)
+            if (b.state == State::Filled) visit(fn, b, arena_);
+    }
+
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (auto const& b : buckets_)
+            if (b.state == State::Filled) visit(fn, b, arena_);
+    }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_type bucket_count() const { return buckets_.size(); }
+    size_type arena_bytes() const { return arena_.size(); }
+
+    void reserve(size_type n) {
+        size_type needed = static_cast<size_type>(n / max_load_factor_) + 1;
+        if (needed > buckets_.size()) rehash(needed);
+    }
+
+    void max_load_factor(float f) {
+        if (f <= 0.1f || f >= 0.95f) throw std::invalid_argument("unreasonable load factor");
+        max_load_factor_ = f;
+        rehash_if_needed();
+    }
+
+    float max_load_factor() const { return max_load_factor_; }
+};
+
 
 #include <iostream>
 #include <string>
 
+#endif // SIMPLE_MAPS_FLAT_MAP_CPP
+
+#ifndef SIMPLE_MAPS_NO_MAIN
 int main() {
     flat_unordered_map<int, std::string> fm;
     fm.reserve(8);
@@ -234,4 +618,4 @@ int main() {
     fm.erase(1);
     std::cout << "size=" << fm.size() << ", buckets=" << fm.bucket_count() << "\n";
 }
-
+#endif
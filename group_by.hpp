@@ -0,0 +1,361 @@
+#pragma once
+// Hash group-by aggregation.
+//
+//   AggregateTable<int, int64_t> t;                  // optional memory budget
+//   t.aggregate(keys, values, n, agg::Sum{});        // any number of times
+//   t.finish(agg::Sum{}, [](const int& k, const agg::Group<int64_t>& g) { ... });
+//
+//   auto t = aggregateParallel(keys, values, n, agg::Sum{}, pool);
+//
+// Each row costs one probe: the slot is found or claimed in the same walk,
+// where `map[key] += value` on flat_unordered_map pays a find and then an
+// insert. Rows go through in groups of kBatch, hashed with the hasher's
+// batch form and with their home slots prefetched before any is updated;
+// room for the whole group is made first, so the table never grows
+// mid-group. Every group also counts its rows.
+//
+// `op(acc, v)` folds v into acc and must be associative and commutative:
+// partial aggregates from other threads and from spill files are folded
+// with the same op, in no particular order. A group's first value
+// initialises its accumulator, so no identity element is needed.
+//
+// Memory budget: when the slot array would outgrow it, groups not updated
+// since the previous spill are written out (all groups, if fewer than a
+// quarter are that cold) to one of kSpillPartitions temporary files chosen
+// by hash. finish() then re-aggregates one spill partition at a time, so a
+// partition, not the whole key space, has to fit. The budget covers the
+// slot array only, not out-of-line key bytes. Spilling needs trivially
+// copyable or std::string keys and trivially copyable values.
+
+#include "hashing.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace agg {
+
+template <class V>
+struct Group {
+    V value;
+    uint64_t count;         // rows folded into value
+};
+
+struct Sum {
+    template <class V>
+    void operator()(V& acc, const V& v) const { acc += v; }
+};
+
+struct Min {
+    template <class V>
+    void operator()(V& acc, const V& v) const { if (v < acc) acc = v; }
+};
+
+struct Max {
+    template <class V>
+    void operator()(V& acc, const V& v) const { if (acc < v) acc = v; }
+};
+
+} // namespace agg
+
+template <class Key, class V, class Hash = hashing::Hash<Key>, class KeyEq = std::equal_to<Key>>
+class AggregateTable {
+    static_assert(std::is_trivially_copyable_v<V>, "aggregate values are spilled as raw bytes");
+
+public:
+    static constexpr size_t kBatch = 16;
+    static constexpr int kSpillBits = 4;
+    static constexpr size_t kSpillPartitions = size_t(1) << kSpillBits;
+
+private:
+    struct Slot {
+        Key key{};
+        agg::Group<V> group{};      // count 0: empty
+        uint32_t tag = 0;
+        bool hot = false;           // updated since the last spill
+    };
+
+    static constexpr size_t kMinSlots = 64;
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    size_t maxSlots_ = SIZE_MAX;    // from the budget
+    Hash hasher_;
+    KeyEq keyeq_;
+
+    std::FILE* spill_[kSpillPartitions] = {};
+    uint64_t spilledRecords_ = 0;
+    uint64_t spills_ = 0;
+
+    uint64_t mask() const { return slots_.size() - 1; }
+    size_t maxLoad() const { return slots_.size() * 7 / 10; }
+
+    static uint32_t tagOf(uint64_t h) { return static_cast<uint32_t>(h >> 20); }
+
+    void hashBatch(const Key* keys, size_t n, uint64_t* out) const {
+        if constexpr (requires { hasher_.many(keys, n, out); }) {
+            hasher_.many(keys, n, out);
+        } else {
+            for (size_t i = 0; i < n; ++i) out[i] = hasher_(keys[i]);
+        }
+    }
+
+    // The group for k, claimed if absent (count stays 0 until the caller
+    // fills it). The caller has made room.
+    Slot& upsert(const Key& k, uint64_t h) {
+        uint32_t tag = tagOf(h);
+        for (uint64_t i = h & mask();; i = (i + 1) & mask()) {
+            Slot& s = slots_[i];
+            if (s.group.count == 0) {
+                s.key = k;
+                s.tag = tag;
+                ++size_;
+                return s;
+            }
+            if (s.tag == tag && keyeq_(s.key, k)) return s;
+        }
+    }
+
+    template <class Op>
+    void fold(const Key& k, uint64_t h, const V& value, uint64_t count, Op& op) {
+        Slot& s = upsert(k, h);
+        if (s.group.count == 0) s.group.value = value;
+        else op(s.group.value, value);
+        s.group.count += count;
+        s.hot = true;
+    }
+
+    // Rebuild with `cap` slots from the groups of `old`.
+    void rebuild(std::vector<Slot> old, size_t cap) {
+        slots_.assign(cap, Slot{});
+        size_ = 0;
+        for (Slot& s : old) {
+            if (!s.group.count) continue;
+            Slot& d = upsert(s.key, hasher_(s.key));
+            d.key = std::move(s.key);
+            d.group = s.group;
+            d.hot = s.hot;
+        }
+    }
+
+    // Make sure `n` more groups fit without growing mid-batch.
+    void makeRoom(size_t n) {
+        if (slots_.empty()) slots_.assign(std::min(kMinSlots, maxSlots_), Slot{});
+        while (size_ + n > maxLoad()) {
+            size_t grown = slots_.size() * 2;
+            if (grown <= maxSlots_) {
+                rebuild(std::move(slots_), grown);
+            } else {
+                spill(false);
+                if (size_ + n > maxLoad()) spill(true);
+            }
+        }
+    }
+
+    // ---------------- spill ----------------
+
+    std::FILE* spillFile(uint64_t h) {
+        std::FILE*& f = spill_[h >> (64 - kSpillBits)];
+        if (!f && !(f = std::tmpfile())) throw std::runtime_error("AggregateTable: cannot create spill file");
+        return f;
+    }
+
+    static void put(std::FILE* f, const void* p, size_t n) {
+        if (std::fwrite(p, 1, n, f) != n) throw std::runtime_error("AggregateTable: spill write failed");
+    }
+
+    static bool get(std::FILE* f, void* p, size_t n) { return std::fread(p, 1, n, f) == n; }
+
+    static void writeRecord(std::FILE* f, const Key& k, const agg::Group<V>& g) {
+        if constexpr (std::is_same_v<Key, std::string>) {
+            uint32_t len = static_cast<uint32_t>(k.size());
+            put(f, &len, sizeof(len));
+            put(f, k.data(), len);
+        } else {
+            static_assert(std::is_trivially_copyable_v<Key>, "spilled keys must be trivially copyable or std::string");
+            put(f, &k, sizeof(Key));
+        }
+        put(f, &g, sizeof(g));
+    }
+
+    static bool readRecord(std::FILE* f, Key& k, agg::Group<V>& g) {
+        if constexpr (std::is_same_v<Key, std::string>) {
+            uint32_t len;
+            if (!get(f, &len, sizeof(len))) return false;
+            k.resize(len);
+            if (!get(f, k.data(), len)) return false;
+        } else {
+            if (!get(f, &k, sizeof(Key))) return false;
+        }
+        return get(f, &g, sizeof(g));
+    }
+
+    // Write cold groups (or all) out and drop them from the table.
+    void spill(bool all) {
+        size_t cold = 0;
+        for (const Slot& s : slots_) cold += s.group.count && !s.hot;
+        if (cold * 4 < size_) all = true;
+        size_t cap = slots_.size();
+        std::vector<Slot> old = std::move(slots_);
+        for (Slot& s : old) {
+            if (!s.group.count || (s.hot && !all)) continue;
+            writeRecord(spillFile(hasher_(s.key)), s.key, s.group);
+            s.group.count = 0;
+            ++spilledRecords_;
+        }
+        for (Slot& s : old) s.hot = false;
+        rebuild(std::move(old), cap);
+        ++spills_;
+    }
+
+    void closeSpills() {
+        for (std::FILE*& f : spill_) {
+            if (f) std::fclose(f);
+            f = nullptr;
+        }
+    }
+
+public:
+    // memoryBudget: bytes for the slot array, 0 for no limit.
+    explicit AggregateTable(size_t memoryBudget = 0) {
+        if (memoryBudget) maxSlots_ = std::bit_floor(std::max(memoryBudget / sizeof(Slot), kMinSlots));
+    }
+
+    AggregateTable(AggregateTable&& o) noexcept
+        : slots_(std::move(o.slots_)), size_(std::exchange(o.size_, 0)), maxSlots_(o.maxSlots_),
+          hasher_(o.hasher_), keyeq_(o.keyeq_), spilledRecords_(std::exchange(o.spilledRecords_, 0)),
+          spills_(std::exchange(o.spills_, 0)) {
+        for (size_t p = 0; p < kSpillPartitions; ++p) spill_[p] = std::exchange(o.spill_[p], nullptr);
+    }
+
+    AggregateTable(const AggregateTable&) = delete;
+    AggregateTable& operator=(const AggregateTable&) = delete;
+    AggregateTable& operator=(AggregateTable&&) = delete;
+    ~AggregateTable() { closeSpills(); }
+
+    // Fold values[i] into the group of keys[i], for i in [0, n).
+    template <class Op>
+    void aggregate(const Key* keys, const V* values, size_t n, Op op) {
+        uint64_t hashes[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            makeRoom(m);
+            hashBatch(keys + base, m, hashes);
+#if defined(__GNUC__) || defined(__clang__)
+            for (size_t j = 0; j < m; ++j) __builtin_prefetch(&slots_[hashes[j] & mask()]);
+#endif
+            for (size_t j = 0; j < m; ++j) fold(keys[base + j], hashes[j], values[base + j], 1, op);
+        }
+    }
+
+    // Fold every group of `other` (in memory and spilled) into this table
+    // and leave `other` empty.
+    template <class Op>
+    void merge(AggregateTable& other, Op op) {
+        for (Slot& s : other.slots_) {
+            if (!s.group.count) continue;
+            makeRoom(1);
+            fold(s.key, hasher_(s.key), s.group.value, s.group.count, op);
+        }
+        other.slots_.clear();
+        other.size_ = 0;
+        for (size_t p = 0; p < kSpillPartitions; ++p) {
+            std::FILE* in = other.spill_[p];
+            if (!in) continue;
+            std::rewind(in);
+            std::FILE* out = spill_[p];
+            if (!out && !(out = spill_[p] = std::tmpfile())) throw std::runtime_error("AggregateTable: cannot create spill file");
+            char buf[1 << 14];
+            for (size_t got; (got = std::fread(buf, 1, sizeof(buf), in)) > 0;) put(out, buf, got);
+        }
+        spilledRecords_ += std::exchange(other.spilledRecords_, 0);
+        spills_ += std::exchange(other.spills_, 0);
+        other.closeSpills();
+    }
+
+    // Emit every group exactly once, as fn(const Key&, const agg::Group<V>&),
+    // and leave the table empty. In-memory groups come first when nothing
+    // was spilled; otherwise everything is emitted partition by partition.
+    template <class Op, class Fn>
+    void finish(Op op, Fn&& fn) {
+        bool spilled = false;
+        for (std::FILE* f : spill_) spilled |= f != nullptr;
+        if (!spilled) {
+            forEach(fn);
+            slots_.clear();
+            size_ = 0;
+            return;
+        }
+        for (Slot& s : slots_)
+            if (s.group.count) writeRecord(spillFile(hasher_(s.key)), s.key, s.group);
+        slots_.clear();
+        size_ = 0;
+        for (std::FILE* f : spill_) {
+            if (!f) continue;
+            std::rewind(f);
+            AggregateTable part;
+            Key k{};
+            agg::Group<V> g;
+            while (readRecord(f, k, g)) {
+                part.makeRoom(1);
+                part.fold(k, part.hasher_(k), g.value, g.count, op);
+            }
+            part.forEach(fn);
+        }
+        closeSpills();
+        spilledRecords_ = 0;
+    }
+
+    // In-memory groups only; nullptr if absent or spilled.
+    const agg::Group<V>* find(const Key& k) const {
+        if (slots_.empty()) return nullptr;
+        uint64_t h = hasher_(k);
+        uint32_t tag = tagOf(h);
+        for (uint64_t i = h & mask();; i = (i + 1) & mask()) {
+            const Slot& s = slots_[i];
+            if (!s.group.count) return nullptr;
+            if (s.tag == tag && keyeq_(s.key, k)) return &s.group;
+        }
+    }
+
+    // In-memory groups: fn(const Key&, const agg::Group<V>&).
+    template <class Fn>
+    void forEach(Fn&& fn) const {
+        for (const Slot& s : slots_)
+            if (s.group.count) fn(s.key, s.group);
+    }
+
+    size_t size() const { return size_; }                     // groups in memory
+    uint64_t spilledRecords() const { return spilledRecords_; }
+    uint64_t spillCount() const { return spills_; }
+    size_t memoryBytes() const { return slots_.size() * sizeof(Slot); }
+};
+
+// Aggregate on a pool: every worker pre-aggregates its chunks into a
+// table of its own (an equal share of the budget), then the partial tables
+// are merged one by one into the result, which gets the whole budget.
+// Merging costs one fold per group per worker, not per row.
+template <class Key, class V, class Op, class Hash = hashing::Hash<Key>>
+AggregateTable<Key, V, Hash> aggregateParallel(const Key* keys, const V* values, size_t n, Op op, ThreadPool& pool,
+                                               size_t memoryBudget = 0, size_t grain = 64 * 1024) {
+    const size_t workers = pool.threadCount() + 1;
+    std::vector<AggregateTable<Key, V, Hash>> locals;
+    locals.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) locals.emplace_back(memoryBudget / workers);
+    pool.parallelFor(n, grain, [&](size_t b, size_t e) {
+        locals[pool.currentSlot()].aggregate(keys + b, values + b, e - b, op);
+    });
+    AggregateTable<Key, V, Hash> result(memoryBudget);
+    for (auto& local : locals) result.merge(local, op);
+    return result;
+}
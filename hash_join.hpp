@@ -0,0 +1,250 @@
+#pragma once
+// Build / probe table for in-memory equi-joins.
+//
+//   JoinTable<int, Order> orders;
+//   orders.build(customerIds, orderRows, &pool);     // once; frozen afterwards
+//   orders.probe(probeIds, [&](size_t i, std::span<const Order> matches) { ... });
+//
+// Rows with the same key are stored contiguously, in build order, so a
+// probe hit is one slot lookup plus a sequential read of its rows; nothing
+// is allocated per key. The build runs in three passes:
+//
+//   1. radix-partition: hash every key and scatter row indices by the top
+//      bits of the hash, via per-chunk histograms and a prefix sum;
+//   2. count: per partition, insert each distinct key into an
+//      open-addressing table (linear probing, as flat_unordered_map) and
+//      count its rows;
+//   3. prefix-sum the counts into row offsets and scatter the rows.
+//
+// Partitions are independent, so with a ThreadPool passes 2 and 3 run one
+// partition per task, and pass 1 one input chunk per task. Partitions are
+// sized to keep each one's slots cache-resident while it is built.
+//
+// Probes run in groups of kProbeBatch: keys are hashed with the hasher's
+// batch form (hashing::Hash vectorises integer keys) and every home slot is
+// prefetched before any is examined. Each slot keeps 32 bits of the hash,
+// so most mismatches are rejected without comparing keys.
+//
+// Row must be default-constructible and copyable; at most 2^32 - 1 rows.
+
+#include "hashing.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+template <class Key, class Row, class Hash = hashing::Hash<Key>, class KeyEq = std::equal_to<Key>>
+class JoinTable {
+public:
+    static constexpr size_t kProbeBatch = 16;
+
+private:
+    struct Slot {
+        Key key{};
+        uint32_t tag = 0;       // bits 20..51 of the hash
+        uint32_t begin = 0;     // first row in rows_
+        uint32_t count = 0;     // 0: empty
+    };
+
+    struct Partition {
+        size_t slotBegin = 0;
+        uint64_t mask = 0;      // slot count - 1 (power of two)
+    };
+
+    static constexpr size_t kRowsPerPartition = 8192;
+    static constexpr int kMaxPartitionBits = 10;
+
+    std::vector<Slot> slots_;
+    std::vector<Partition> parts_;
+    std::vector<Row> rows_;
+    int partBits_ = 0;
+    size_t distinct_ = 0;
+    Hash hasher_;
+    KeyEq keyeq_;
+
+    void hashBatch(const Key* keys, size_t n, uint64_t* out) const {
+        if constexpr (requires { hasher_.many(keys, n, out); }) {
+            hasher_.many(keys, n, out);
+        } else {
+            for (size_t i = 0; i < n; ++i) out[i] = hasher_(keys[i]);
+        }
+    }
+
+    size_t partitionOf(uint64_t h) const { return partBits_ ? static_cast<size_t>(h >> (64 - partBits_)) : 0; }
+
+    // Clear of the partition bits (top) and, for partitions below 2^20
+    // slots, of the slot index (bottom).
+    static uint32_t tagOf(uint64_t h) { return static_cast<uint32_t>(h >> 20); }
+
+    const Slot* lookup(const Key& k, uint64_t h) const {
+        const Partition& p = parts_[partitionOf(h)];
+        uint32_t tag = tagOf(h);
+        for (uint64_t i = h & p.mask;; i = (i + 1) & p.mask) {
+            const Slot& s = slots_[p.slotBegin + i];
+            if (s.count == 0) return nullptr;
+            if (s.tag == tag && keyeq_(s.key, k)) return &s;
+        }
+    }
+
+    template <class Fn>
+    static void forRange(ThreadPool* pool, size_t n, size_t grain, Fn&& fn) {
+        if (pool) pool->parallelFor(n, grain, fn);
+        else if (n) fn(size_t(0), n);
+    }
+
+public:
+    JoinTable() = default;
+
+    // Replace the contents with rows[i] under keys[i]. Build-side keys and
+    // rows must be the same length.
+    void build(std::span<const Key> keys, std::span<const Row> rows, ThreadPool* pool = nullptr) {
+        if (keys.size() != rows.size()) throw std::invalid_argument("JoinTable: keys and rows differ in length");
+        if (keys.size() >= UINT32_MAX) throw std::length_error("JoinTable: too many build rows");
+        const size_t n = keys.size();
+        const size_t workers = pool ? pool->threadCount() + 1 : 1;
+
+        size_t wantParts = std::max(n / kRowsPerPartition, workers > 1 ? 4 * workers : size_t(1));
+        partBits_ = std::min(kMaxPartitionBits, static_cast<int>(std::bit_width(std::bit_ceil(wantParts)) - 1));
+        const size_t numParts = size_t(1) << partBits_;
+
+        // 1. hash and radix-partition row indices
+        std::vector<uint64_t> hashes(n);
+        const size_t chunks = std::min(n ? (n + kRowsPerPartition - 1) / kRowsPerPartition : 1, 4 * workers);
+        const size_t chunkLen = n ? (n + chunks - 1) / chunks : 0;
+        std::vector<uint32_t> hist(chunks * numParts, 0);    // [chunk][partition]
+        forRange(pool, chunks, 1, [&](size_t c0, size_t c1) {
+            for (size_t c = c0; c < c1; ++c) {
+                size_t b = std::min(n, c * chunkLen), e = std::min(n, b + chunkLen);
+                for (size_t i = b; i < e; i += kProbeBatch)
+                    hashBatch(keys.data() + i, std::min(kProbeBatch, e - i), hashes.data() + i);
+                uint32_t* h = &hist[c * numParts];
+                for (size_t i = b; i < e; ++i) ++h[partitionOf(hashes[i])];
+            }
+        });
+
+        // Exclusive prefix sum in (partition, chunk) order: each chunk gets
+        // its own range inside every partition, so scatter needs no atomics
+        // and rows keep their input order.
+        std::vector<uint32_t> partBegin(numParts + 1, 0);
+        uint32_t running = 0;
+        for (size_t p = 0; p < numParts; ++p) {
+            partBegin[p] = running;
+            for (size_t c = 0; c < chunks; ++c) {
+                uint32_t count = hist[c * numParts + p];
+                hist[c * numParts + p] = running;
+                running += count;
+            }
+        }
+        partBegin[numParts] = running;
+
+        std::vector<uint32_t> order(n);
+        forRange(pool, chunks, 1, [&](size_t c0, size_t c1) {
+            for (size_t c = c0; c < c1; ++c) {
+                size_t b = std::min(n, c * chunkLen), e = std::min(n, b + chunkLen);
+                uint32_t* cursor = &hist[c * numParts];
+                for (size_t i = b; i < e; ++i) order[cursor[partitionOf(hashes[i])]++] = static_cast<uint32_t>(i);
+            }
+        });
+
+        // Slot tables: a power of two at least twice each partition's rows.
+        parts_.assign(numParts, Partition{});
+        size_t totalSlots = 0;
+        for (size_t p = 0; p < numParts; ++p) {
+            size_t len = partBegin[p + 1] - partBegin[p];
+            size_t cap = std::bit_ceil(std::max<size_t>(2 * len, 2));
+            parts_[p] = {totalSlots, cap - 1};
+            totalSlots += cap;
+        }
+        slots_.assign(totalSlots, Slot{});
+        rows_.assign(n, Row{});
+
+        // 2 + 3. count, prefix-sum, scatter; one partition at a time
+        std::vector<uint32_t> slotOf(n);         // indexed like `order`
+        std::vector<size_t> distinct(numParts, 0);
+        forRange(pool, numParts, 1, [&](size_t p0, size_t p1) {
+            for (size_t p = p0; p < p1; ++p) {
+                const Partition& part = parts_[p];
+                Slot* table = &slots_[part.slotBegin];
+                for (uint32_t j = partBegin[p]; j < partBegin[p + 1]; ++j) {
+                    uint32_t i = order[j];
+                    uint64_t h = hashes[i];
+                    uint32_t tag = tagOf(h);
+                    uint64_t s = h & part.mask;
+                    while (table[s].count && !(table[s].tag == tag && keyeq_(table[s].key, keys[i])))
+                        s = (s + 1) & part.mask;
+                    if (table[s].count++ == 0) {
+                        table[s].key = keys[i];
+                        table[s].tag = tag;
+                        ++distinct[p];
+                    }
+                    slotOf[j] = static_cast<uint32_t>(s);
+                }
+
+                uint32_t offset = partBegin[p];
+                for (uint64_t s = 0; s <= part.mask; ++s) {
+                    table[s].begin = offset;
+                    offset += table[s].count;
+                }
+
+                // `begin` doubles as the write cursor, then is restored.
+                for (uint32_t j = partBegin[p]; j < partBegin[p + 1]; ++j)
+                    rows_[table[slotOf[j]].begin++] = rows[order[j]];
+                for (uint64_t s = 0; s <= part.mask; ++s) table[s].begin -= table[s].count;
+            }
+        });
+
+        distinct_ = 0;
+        for (size_t d : distinct) distinct_ += d;
+    }
+
+    // Rows stored under `key`, in build order; empty if none.
+    std::span<const Row> find(const Key& key) const {
+        if (parts_.empty()) return {};
+        const Slot* s = lookup(key, hasher_(key));
+        return s ? std::span<const Row>(rows_.data() + s->begin, s->count) : std::span<const Row>();
+    }
+
+    // For every probe key with matches, emit(i, rows) with i its index in
+    // `keys`, in order. Returns the total number of matching rows.
+    template <class Fn>
+    size_t probe(std::span<const Key> keys, Fn&& emit) const {
+        if (parts_.empty()) return 0;
+        uint64_t hashes[kProbeBatch];
+        size_t matches = 0;
+        for (size_t base = 0; base < keys.size(); base += kProbeBatch) {
+            size_t n = std::min(kProbeBatch, keys.size() - base);
+            const Key* group = keys.data() + base;
+            hashBatch(group, n, hashes);
+#if defined(__GNUC__) || defined(__clang__)
+            for (size_t j = 0; j < n; ++j) {
+                const Partition& p = parts_[partitionOf(hashes[j])];
+                __builtin_prefetch(&slots_[p.slotBegin + (hashes[j] & p.mask)]);
+            }
+#endif
+            for (size_t j = 0; j < n; ++j) {
+                const Slot* s = lookup(group[j], hashes[j]);
+                if (!s) continue;
+                matches += s->count;
+                emit(base + j, std::span<const Row>(rows_.data() + s->begin, s->count));
+            }
+        }
+        return matches;
+    }
+
+    size_t size() const { return rows_.size(); }
+    size_t distinctKeys() const { return distinct_; }
+    size_t partitionCount() const { return parts_.size(); }
+
+    // Every stored key with its rows, partition by partition.
+    template <class Fn>
+    void forEach(Fn&& fn) const {
+        for (const Slot& s : slots_)
+            if (s.count) fn(s.key, std::span<const Row>(rows_.data() + s.begin, s.count));
+    }
+};
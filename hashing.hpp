@@ -0,0 +1,348 @@
+#pragma once
+// Hash functions for the containers.
+//
+//   hashing::hashBytes(p, len)       wyhash (final4 layout): strings and other byte keys
+//   hashing::hashInt(x)              splitmix64 finaliser: integer keys
+//   hashing::hashMany(keys, n, out)  the same hashes for a batch of keys
+//   hashing::Hash<K>                 functor picking the above; the default
+//                                    hasher of flat_unordered_map
+//
+// Both hashes mix every input bit into the low bits, so power-of-two tables
+// can mask them directly (std::hash<int> is the identity, which clusters
+// keys sharing their low bits). They are not keyed and give no protection
+// against deliberate flooding.
+//
+// hashMany over int32 / uint64 keys runs 8 (AVX2) or 16 (AVX-512) keys per
+// iteration through the kernels below, dispatched by simd_dispatch.hpp at
+// the level simd::activeLevel() picked, and returns exactly what hashInt
+// would for each key. String batches are hashed one by one; independent
+// keys still overlap in the pipeline.
+
+#include "simd_dispatch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace hashing {
+
+// ---------------- scalar ----------------
+
+namespace detail {
+
+inline constexpr uint64_t kSecret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull,
+                                        0x4d5a2da51de1aa47ull};
+
+// 64 x 64 -> 128 multiply, low half in a, high half in b.
+inline void mum(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    mum(a, b);
+    return a ^ b;
+}
+
+// Unaligned little-endian reads (memcpy compiles to a plain load).
+inline uint64_t read8(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint64_t read4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// 1..3 bytes: first, middle and last byte.
+inline uint64_t read3(const uint8_t* p, size_t k) {
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+} // namespace detail
+
+// wyhash: up to 16 bytes take two overlapping reads and one multiply;
+// longer keys run three independent 48-byte lanes, then 16-byte steps.
+inline uint64_t hashBytes(const void* key, size_t len, uint64_t seed = 0) {
+    using namespace detail;
+    const uint8_t* p = static_cast<const uint8_t*>(key);
+    seed ^= mix(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + off);
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - off);
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ kSecret[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ kSecret[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
+
+inline uint64_t hashBytes(std::string_view s, uint64_t seed = 0) { return hashBytes(s.data(), s.size(), seed); }
+
+namespace detail {
+
+inline constexpr uint64_t kGamma = 0x9e3779b97f4a7c15ull;
+inline constexpr uint64_t kMul1 = 0xbf58476d1ce4e5b9ull;
+inline constexpr uint64_t kMul2 = 0x94d049bb133111ebull;
+
+} // namespace detail
+
+// Bijective, so distinct keys never collide before masking. Signed keys
+// are sign-extended: hashInt(int(-1)) == hashInt(int64_t(-1)).
+inline uint64_t hashInt(uint64_t x) {
+    x += detail::kGamma;
+    x = (x ^ (x >> 30)) * detail::kMul1;
+    x = (x ^ (x >> 27)) * detail::kMul2;
+    return x ^ (x >> 31);
+}
+
+// Batch kernels: out[i] = hashInt(keys[i]).
+struct Kernels {
+    simd::Level level;
+    void (*ints32)(const int32_t* keys, size_t n, uint64_t* out);
+    void (*ints64)(const uint64_t* keys, size_t n, uint64_t* out);
+};
+
+namespace scalar {
+
+inline void ints32(const int32_t* keys, size_t n, uint64_t* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = hashInt(static_cast<uint64_t>(static_cast<int64_t>(keys[i])));
+}
+
+inline void ints64(const uint64_t* keys, size_t n, uint64_t* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = hashInt(keys[i]);
+}
+
+} // namespace scalar
+
+#ifdef SIMD_DISPATCH_X86
+
+// No level below AVX-512DQ has a 64-bit low multiply, so each one is built
+// from three 32 x 32 -> 64 multiplies: lo*lo + ((hi*lo + lo*hi) << 32).
+// With only two 64-bit lanes that loses to the scalar loop, so SSE4.2
+// hosts hash with the scalar kernels.
+
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline __m256i mullo64(__m256i x, __m256i c, __m256i cHi) {
+    __m256i lo = _mm256_mul_epu32(x, c);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c), _mm256_mul_epu32(x, cHi));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2"))) inline __m256i mix(__m256i x) {
+    const __m256i m1 = _mm256_set1_epi64x(static_cast<long long>(detail::kMul1));
+    const __m256i m1Hi = _mm256_set1_epi64x(static_cast<long long>(detail::kMul1 >> 32));
+    const __m256i m2 = _mm256_set1_epi64x(static_cast<long long>(detail::kMul2));
+    const __m256i m2Hi = _mm256_set1_epi64x(static_cast<long long>(detail::kMul2 >> 32));
+    x = _mm256_add_epi64(x, _mm256_set1_epi64x(static_cast<long long>(detail::kGamma)));
+    x = mullo64(_mm256_xor_si256(x, _mm256_srli_epi64(x, 30)), m1, m1Hi);
+    x = mullo64(_mm256_xor_si256(x, _mm256_srli_epi64(x, 27)), m2, m2Hi);
+    return _mm256_xor_si256(x, _mm256_srli_epi64(x, 31));
+}
+
+// 8 keys per iteration: two independent 4-lane chains.
+__attribute__((target("avx2"))) inline void ints32(const int32_t* keys, size_t n, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i a = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(k));
+        __m256i b = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(k, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), mix(a));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 4), mix(b));
+    }
+    scalar::ints32(keys + i, n - i, out + i);
+}
+
+__attribute__((target("avx2"))) inline void ints64(const uint64_t* keys, size_t n, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i + 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), mix(a));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 4), mix(b));
+    }
+    scalar::ints64(keys + i, n - i, out + i);
+}
+
+} // namespace avx2
+
+// GCC 12 flags the _mm512_undefined_* pass-through operands inside the
+// intrinsics as maybe-uninitialized once they are inlined here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace avx512 {
+
+__attribute__((target("avx512f"))) inline __m512i mullo64(__m512i x, __m512i c, __m512i cHi) {
+    __m512i lo = _mm512_mul_epu32(x, c);
+    __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(x, 32), c), _mm512_mul_epu32(x, cHi));
+    return _mm512_add_epi64(lo, _mm512_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx512f"))) inline __m512i mix(__m512i x) {
+    const __m512i m1 = _mm512_set1_epi64(static_cast<long long>(detail::kMul1));
+    const __m512i m1Hi = _mm512_set1_epi64(static_cast<long long>(detail::kMul1 >> 32));
+    const __m512i m2 = _mm512_set1_epi64(static_cast<long long>(detail::kMul2));
+    const __m512i m2Hi = _mm512_set1_epi64(static_cast<long long>(detail::kMul2 >> 32));
+    x = _mm512_add_epi64(x, _mm512_set1_epi64(static_cast<long long>(detail::kGamma)));
+    x = mullo64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 30)), m1, m1Hi);
+    x = mullo64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 27)), m2, m2Hi);
+    return _mm512_xor_si512(x, _mm512_srli_epi64(x, 31));
+}
+
+// 16 keys per iteration: two independent 8-lane chains.
+__attribute__((target("avx512f"))) inline void ints32(const int32_t* keys, size_t n, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i k = _mm512_loadu_si512(keys + i);
+        __m512i a = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(k));
+        __m512i b = _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(k, 1));
+        _mm512_storeu_si512(out + i, mix(a));
+        _mm512_storeu_si512(out + i + 8, mix(b));
+    }
+    scalar::ints32(keys + i, n - i, out + i);
+}
+
+__attribute__((target("avx512f"))) inline void ints64(const uint64_t* keys, size_t n, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_si512(out + i, mix(_mm512_loadu_si512(keys + i)));
+        _mm512_storeu_si512(out + i + 8, mix(_mm512_loadu_si512(keys + i + 8)));
+    }
+    scalar::ints64(keys + i, n - i, out + i);
+}
+
+} // namespace avx512
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SIMD_DISPATCH_X86
+
+// Kernel table for `level`, or for the best supported level below it.
+inline Kernels kernelsFor(simd::Level level) {
+    level = simd::kernelsFor(level).level;
+    switch (level) {
+#ifdef SIMD_DISPATCH_X86
+    case simd::Level::AVX512: return {level, avx512::ints32, avx512::ints64};
+    case simd::Level::AVX2:   return {level, avx2::ints32, avx2::ints64};
+    case simd::Level::SSE42:  return {level, scalar::ints32, scalar::ints64};
+#endif
+    default:                  return {simd::Level::Scalar, scalar::ints32, scalar::ints64};
+    }
+}
+
+// Resolved once, at the level simd::kernels() runs at.
+inline const Kernels& kernels() {
+    static const Kernels table = hashing::kernelsFor(simd::activeLevel());
+    return table;
+}
+
+// ---------------- batch API ----------------
+
+inline void hashMany(const int32_t* keys, size_t n, uint64_t* out) { kernels().ints32(keys, n, out); }
+inline void hashMany(const uint64_t* keys, size_t n, uint64_t* out) { kernels().ints64(keys, n, out); }
+inline void hashMany(const int64_t* keys, size_t n, uint64_t* out) {
+    kernels().ints64(reinterpret_cast<const uint64_t*>(keys), n, out);
+}
+
+template <class S>
+    requires std::is_convertible_v<const S&, std::string_view>
+inline void hashMany(const S* keys, size_t n, uint64_t* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = hashBytes(std::string_view(keys[i]));
+}
+
+// ---------------- functor ----------------
+
+// Hash<K>::many(keys, n, out) is the batch form; containers detect it and
+// use it for their batch operations. Types other than integers and
+// strings fall back to std::hash and have no batch form.
+template <class K, class = void>
+struct Hash : std::hash<K> {};
+
+template <class K>
+struct Hash<K, std::enable_if_t<std::is_integral_v<K>>> {
+    size_t operator()(K k) const {
+        if constexpr (std::is_signed_v<K>) return static_cast<size_t>(hashInt(static_cast<uint64_t>(static_cast<int64_t>(k))));
+        else return static_cast<size_t>(hashInt(static_cast<uint64_t>(k)));
+    }
+
+    void many(const K* keys, size_t n, uint64_t* out) const {
+        if constexpr (sizeof(K) == 4 && std::is_signed_v<K>) hashMany(reinterpret_cast<const int32_t*>(keys), n, out);
+        else if constexpr (sizeof(K) == 8) hashMany(reinterpret_cast<const uint64_t*>(keys), n, out);
+        else for (size_t i = 0; i < n; ++i) out[i] = (*this)(keys[i]);
+    }
+};
+
+// Transparent: std::string, std::string_view and const char* hash alike.
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return static_cast<size_t>(hashBytes(s)); }
+
+    template <class S>
+    void many(const S* keys, size_t n, uint64_t* out) const { hashMany(keys, n, out); }
+};
+
+template <>
+struct Hash<std::string> : StringHash {};
+template <>
+struct Hash<std::string_view> : StringHash {};
+
+} // namespace hashing
@@ -1,5 +1,12 @@
+#ifndef SIMPLE_MAPS_MAP_CPP
+#define SIMPLE_MAPS_MAP_CPP
+
 #include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <utility>
+#include <vector>
 
 template <typename Key, typename Value>
 class SimpleMap {
@@ -44,6 +51,14 @@ class SimpleMap {
         delete node;
     }
 
+    template <typename Fn>
+    static void inorder(Node* node, Fn& fn) {
+        if (!node) return;
+        inorder(node->left, fn);
+        fn(static_cast<const Key&>(node->key), node->value);
+        inorder(node->right, fn);
+    }
+
     void inorder(Node* node) const {
         if (!node) return;
         inorder(node->left);
@@ -63,11 +78,214 @@ public:
         return n ? &n->value : nullptr;
     }
 
+    // visit keys in sorted order: fn(const Key&, Value&)
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        inorder(root, fn);
+    }
+
     void printInOrder() const {
         inorder(root);
     }
 };
 
+// Ordered map that stays balanced: a treap (a BST by key that is also a
+// max-heap by random priority), so keys inserted in sorted order no longer
+// degrade it into a list, and recursion depth stays O(log n). Adds erase,
+// size, range visits and an O(n) bulk build from sorted pairs on top of
+// what SimpleMap offers.
+template <typename Key, typename Value>
+class OrderedMap {
+    struct Node {
+        Key key;
+        Value value;
+        uint32_t priority;
+        Node* left = nullptr;
+        Node* right = nullptr;
+        Node(Key k, Value v, uint32_t p) : key(std::move(k)), value(std::move(v)), priority(p) {}
+    };
+
+    Node* root = nullptr;
+    size_t count = 0;
+    uint32_t rng = 0x9E3779B9u;
+
+    uint32_t nextPriority() {                   // xorshift32
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+
+    static Node* rotateRight(Node* n) {
+        Node* l = n->left;
+        n->left = l->right;
+        l->right = n;
+        return l;
+    }
+
+    static Node* rotateLeft(Node* n) {
+        Node* r = n->right;
+        n->right = r->left;
+        r->left = n;
+        return r;
+    }
+
+    Node* insert(Node* node, const Key& key, const Value& value, bool& inserted) {
+        if (!node) {
+            inserted = true;
+            return new Node(key, value, nextPriority());
+        }
+        if (key < node->key) {
+            node->left = insert(node->left, key, value, inserted);
+            if (node->left->priority > node->priority) node = rotateRight(node);
+        } else if (node->key < key) {
+            node->right = insert(node->right, key, value, inserted);
+            if (node->right->priority > node->priority) node = rotateLeft(node);
+        } else {
+            node->value = value;
+        }
+        return node;
+    }
+
+    // Join two treaps where every key in a is below every key in b.
+    static Node* merge(Node* a, Node* b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->priority > b->priority) {
+            a->right = merge(a->right, b);
+            return a;
+        }
+        b->left = merge(a, b->left);
+        return b;
+    }
+
+    Node* erase(Node* node, const Key& key, bool& erased) {
+        if (!node) return nullptr;
+        if (key < node->key) {
+            node->left = erase(node->left, key, erased);
+        } else if (node->key < key) {
+            node->right = erase(node->right, key, erased);
+        } else {
+            Node* joined = merge(node->left, node->right);
+            delete node;
+            erased = true;
+            return joined;
+        }
+        return node;
+    }
+
+    static void destroy(Node* node) {
+        if (!node) return;
+        destroy(node->left);
+        destroy(node->right);
+        delete node;
+    }
+
+    template <typename Fn>
+    static void inorder(Node* node, Fn& fn) {
+        if (!node) return;
+        inorder(node->left, fn);
+        fn(static_cast<const Key&>(node->key), node->value);
+        inorder(node->right, fn);
+    }
+
+    template <typename Fn>
+    static void inRange(Node* node, const Key& lo, const Key& hi, Fn& fn) {
+        if (!node) return;
+        bool aboveLo = !(node->key < lo);
+        bool belowHi = node->key < hi;
+        if (aboveLo) inRange(node->left, lo, hi, fn);
+        if (aboveLo && belowHi) fn(static_cast<const Key&>(node->key), node->value);
+        if (belowHi) inRange(node->right, lo, hi, fn);
+    }
+
+    // Perfectly balanced subtree over items[lo, hi).
+    static Node* build(std::vector<std::pair<Key, Value>>& items, size_t lo, size_t hi) {
+        if (lo == hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        Node* n = new Node(std::move(items[mid].first), std::move(items[mid].second), 0);
+        n->left = build(items, lo, mid);
+        n->right = build(items, mid + 1, hi);
+        return n;
+    }
+
+public:
+    OrderedMap() = default;
+    OrderedMap(const OrderedMap&) = delete;
+    OrderedMap& operator=(const OrderedMap&) = delete;
+    ~OrderedMap() { destroy(root); }
+
+    // insert or assign; true if the key was new
+    bool insert(const Key& key, const Value& value) {
+        bool inserted = false;
+        root = insert(root, key, value, inserted);
+        count += inserted;
+        return inserted;
+    }
+
+    Value* find(const Key& key) {
+        Node* n = root;
+        while (n) {
+            if (key < n->key) n = n->left;
+            else if (n->key < key) n = n->right;
+            else return &n->value;
+        }
+        return nullptr;
+    }
+
+    bool erase(const Key& key) {
+        bool erased = false;
+        root = erase(root, key, erased);
+        count -= erased;
+        return erased;
+    }
+
+    size_t size() const { return count; }
+
+    void clear() {
+        destroy(root);
+        root = nullptr;
+        count = 0;
+    }
+
+    // Replace the contents with `items`, which must be sorted by key with
+    // no duplicates. Builds a balanced tree in O(n), then hands out random
+    // priorities in descending order level by level, so the heap property
+    // holds and later inserts and erases behave as in a random treap.
+    void assignSorted(std::vector<std::pair<Key, Value>> items) {
+        clear();
+        root = build(items, 0, items.size());
+        count = items.size();
+
+        std::vector<uint32_t> priorities(count);
+        for (auto& p : priorities) p = nextPriority();
+        std::sort(priorities.begin(), priorities.end(), std::greater<>());
+        std::vector<Node*> level;
+        if (root) level.push_back(root);
+        for (size_t head = 0, next = 0; head < level.size(); ++head) {
+            Node* n = level[head];
+            n->priority = priorities[next++];
+            if (n->left) level.push_back(n->left);
+            if (n->right) level.push_back(n->right);
+        }
+    }
+
+    // visit keys in sorted order: fn(const Key&, Value&)
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        inorder(root, fn);
+    }
+
+    // visit keys in [lo, hi) in sorted order, skipping subtrees outside it
+    template <typename Fn>
+    void forEachInRange(const Key& lo, const Key& hi, Fn&& fn) {
+        inRange(root, lo, hi, fn);
+    }
+};
+
+#endif // SIMPLE_MAPS_MAP_CPP
+
+#ifndef SIMPLE_MAPS_NO_MAIN
 // ---------------- Example ----------------
 int main() {
     SimpleMap<int, std::string> map;
@@ -84,5 +302,14 @@ int main() {
         std::cout << "Key 3 not found\n";
     }
 
+    // Balanced successor: sorted inserts stay O(log n), plus erase and ranges
+    OrderedMap<int, std::string> ordered;
+    for (int k = 0; k < 1000; ++k) ordered.insert(k, "v" + std::to_string(k));
+    ordered.erase(500);
+    std::cout << "OrderedMap holds " << ordered.size() << " keys; [498, 503):";
+    ordered.forEachInRange(498, 503, [](int k, std::string&) { std::cout << " " << k; });
+    std::cout << "\n";
+
     return 0;
 }
+#endif
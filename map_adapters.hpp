@@ -0,0 +1,201 @@
+#pragma once
+// Uniform adapters over the map designs, for the benchmark and replay
+// tools. Each adapter exposes:
+//
+//   Engine(size_t expected)             expected element count (only used
+//                                       where the container cannot grow)
+//   void insert(const K&, uint64_t)     insert or assign
+//   bool find(const K&)
+//   bool erase(const K&)                only if kErase
+//   size_t size()
+//   uint64_t iterate()                  visit all elements, return a checksum
+//
+// Values are uint64_t, except UnorderedMap which is fixed to
+// int -> std::string and stores a short (SSO) string.
+
+// Keep an includer's own SIMPLE_MAPS_NO_MAIN in effect after this block.
+#ifndef SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN
+#define SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+#include "flat_buffered_unordered_map.cpp"
+#include "map.cpp"
+#include "unordered_map.cpp"
+#include "vector_with_index_map.cpp"
+#ifdef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#undef SIMPLE_MAPS_NO_MAIN
+#undef SIMPLE_MAPS_NO_MAIN_SET_HERE
+#endif
+#include "adaptive_map.hpp"
+#include "durable_map.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+
+namespace adapters {
+
+template <class K>
+struct FlatEngine {
+    static constexpr const char* kName = "flat_unordered_map";
+    static constexpr bool kErase = true;
+
+    flat_unordered_map<K, uint64_t> m;
+
+    explicit FlatEngine(size_t) {}
+    void insert(const K& k, uint64_t v) { m.insert_or_assign(k, v); }
+    bool find(const K& k) { return m.find(k) != nullptr; }
+    bool erase(const K& k) { return m.erase(k); }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.for_each([&](auto const&, uint64_t& v) { sum += v; });
+        return sum;
+    }
+};
+
+template <class K>
+struct SimpleMapEngine {
+    static constexpr const char* kName = "SimpleMap";
+    static constexpr bool kErase = false;
+
+    SimpleMap<K, uint64_t> m;
+    size_t count = 0;
+
+    explicit SimpleMapEngine(size_t) {}
+    void insert(const K& k, uint64_t v) {
+        if (!m.find(k)) ++count;
+        m.insert(k, v);
+    }
+    bool find(const K& k) { return m.find(k) != nullptr; }
+    bool erase(const K&) { return false; }
+    size_t size() const { return count; }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.forEach([&](const K&, uint64_t& v) { sum += v; });
+        return sum;
+    }
+};
+
+template <class K>
+struct OrderedMapEngine {
+    static constexpr const char* kName = "OrderedMap";
+    static constexpr bool kErase = true;
+
+    OrderedMap<K, uint64_t> m;
+
+    explicit OrderedMapEngine(size_t) {}
+    void insert(const K& k, uint64_t v) { m.insert(k, v); }
+    bool find(const K& k) { return m.find(k) != nullptr; }
+    bool erase(const K& k) { return m.erase(k); }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.forEach([&](const K&, uint64_t& v) { sum += v; });
+        return sum;
+    }
+};
+
+// The benchmark workloads are all point operations, so this measures the
+// Small -> Hashed path plus the cost of the mode dispatch and accounting.
+template <class K>
+struct AdaptiveMapEngine {
+    static constexpr const char* kName = "AdaptiveMap";
+    static constexpr bool kErase = true;
+
+    AdaptiveMap<K, uint64_t> m;
+
+    explicit AdaptiveMapEngine(size_t) {}
+    void insert(const K& k, uint64_t v) { m.insert(k, v); }
+    bool find(const K& k) { return m.find(k) != nullptr; }
+    bool erase(const K& k) { return m.erase(k); }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.forEach([&](const K&, uint64_t& v) { sum += v; });
+        return sum;
+    }
+};
+
+// DurableMap logging to a fresh directory under $TMPDIR (default /tmp),
+// removed afterwards. Default options: no commit() per operation, so this
+// measures the logging overhead on top of FlatEngine, not sync latency.
+template <class K>
+struct DurableMapEngine {
+    static constexpr const char* kName = "DurableMap";
+    static constexpr bool kErase = true;
+
+    std::string dir;
+    DurableMap<K, uint64_t> m;
+
+    explicit DurableMapEngine(size_t) {
+        const char* tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/durable_map.XXXXXX";
+        if (mkdtemp(pattern.data()) && m.open(pattern)) dir = pattern;
+    }
+    ~DurableMapEngine() {
+        m.close();
+        std::error_code ec;
+        if (!dir.empty()) std::filesystem::remove_all(dir, ec);
+    }
+    void insert(const K& k, uint64_t v) { m.insert_or_assign(k, v); }
+    bool find(const K& k) { return m.find(k) != nullptr; }
+    bool erase(const K& k) { return m.erase(k); }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.for_each([&](auto const&, const uint64_t& v) { sum += v; });
+        return sum;
+    }
+};
+
+// UnorderedMap never rehashes, so it is sized for the expected count up
+// front; with its default 8 buckets every workload would be quadratic.
+struct UnorderedMapEngine {
+    static constexpr const char* kName = "UnorderedMap";
+    static constexpr bool kErase = true;
+
+    UnorderedMap m;
+
+    explicit UnorderedMapEngine(size_t expected) : m(expected ? expected : 8) {}
+    void insert(int k, uint64_t v) { m.insert(k, v & 1 ? "odd" : "even"); }
+    bool find(int k) { return m.find(k) != nullptr; }
+    bool erase(int k) {
+        size_t before = m.size();
+        m.erase(k);
+        return m.size() != before;
+    }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        m.forEach([&](int k, std::string& v) { sum += static_cast<uint64_t>(k) + v.size(); });
+        return sum;
+    }
+};
+
+// Key is the entity id, value is stored as health.
+struct EntityManagerEngine {
+    static constexpr const char* kName = "EntityManager";
+    static constexpr bool kErase = true;
+
+    EntityManager m;
+
+    explicit EntityManagerEngine(size_t) {}
+    void insert(int k, uint64_t v) { m.upsertEntity(k, "v", static_cast<float>(v & 0xffff)); }
+    bool find(int k) { return m.getEntity(k) != nullptr; }
+    bool erase(int k) {
+        size_t before = m.size();
+        m.removeEntity(k);
+        return m.size() != before;
+    }
+    size_t size() const { return m.size(); }
+    uint64_t iterate() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < m.size(); ++i) sum += static_cast<uint64_t>(m.entityAt(i).health);
+        return sum;
+    }
+};
+
+} // namespace adapters
@@ -0,0 +1,519 @@
+// Cross-container benchmark: drives flat_unordered_map, SimpleMap,
+// OrderedMap, AdaptiveMap, DurableMap, UnorderedMap and EntityManager
+// through the adapters in map_adapters.hpp.
+//
+//   g++ -std=c++20 -O2 -pthread map_bench.cpp -o map_bench
+//   ./map_bench [--n=100000] [--engines=flat,simple,ordered,adaptive,durable,unordered,entity]
+//               [--workloads=insert,hit,miss,churn,iterate,mixed90,mixed50]
+//               [--dists=uniform,sequential,zipf,adversarial] [--keys=int,string]
+//               [--cap=8192] [--seed=1] [--format=csv|json] [--no-fork] [--alloc]
+//
+// Every (engine, key type, distribution, workload) case runs in a forked
+// child so its peak RSS is its own. Workloads that degrade quadratically
+// (adversarial keys, SimpleMap on sequential keys) are limited to --cap
+// elements; the row reports the n actually used. Engines without erase
+// skip churn and mixed workloads, and int-only engines skip string keys.
+//
+// Output, one row per case: ns/op, Mops/s, sampled per-op latency
+// percentiles (1 op in 8 is timed individually with the TSC and recorded
+// in an HDR histogram, see op_latency.hpp), peak RSS and, where perf
+// counters can be opened, cycles, instructions, branch misses and L1D /
+// LLC / dTLB misses per op (empty / null otherwise). Counters cover the
+// whole timed loop, latency sampling included, on the calling thread and
+// on threads the engine runs (DurableMap's log writer and checkpoints).
+//
+// With --alloc, global operator new / delete are counted during the timed
+// loop (alloc_tracker.hpp): allocations and requested bytes per op, peak
+// growth of live heap bytes, and a histogram of requested sizes. Tracking
+// adds a few atomic ops per allocation, so compare timings only between
+// runs with the same setting.
+
+#include "map_adapters.hpp"
+#include "bench_util.hpp"
+#include "op_latency.hpp"
+
+#define BENCH_TRACK_ALLOCATIONS
+#include "alloc_tracker.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#define MAP_BENCH_HAVE_FORK 1
+#endif
+
+namespace {
+
+enum class Dist { Uniform, Sequential, Zipf, Adversarial };
+enum class Workload { Insert, LookupHit, LookupMiss, EraseChurn, Iterate, Mixed90, Mixed50 };
+
+const char* distName(Dist d) {
+    switch (d) {
+    case Dist::Uniform:     return "uniform";
+    case Dist::Sequential:  return "sequential";
+    case Dist::Zipf:        return "zipf";
+    case Dist::Adversarial: return "adversarial";
+    }
+    return "?";
+}
+
+const char* workloadName(Workload w) {
+    switch (w) {
+    case Workload::Insert:     return "insert";
+    case Workload::LookupHit:  return "hit";
+    case Workload::LookupMiss: return "miss";
+    case Workload::EraseChurn: return "churn";
+    case Workload::Iterate:    return "iterate";
+    case Workload::Mixed90:    return "mixed90";
+    case Workload::Mixed50:    return "mixed50";
+    }
+    return "?";
+}
+
+struct Options {
+    size_t n = 100000;
+    size_t cap = 8192;
+    uint64_t seed = 1;
+    bool json = false;
+    bool fork = true;
+    bool allocs = false;
+    std::set<std::string> engines, workloads, dists, keys;
+};
+
+struct Result {
+    std::string engine, key, dist, workload;
+    size_t n = 0, ops = 0;
+    double nsPerOp = 0, p50 = 0, p99 = 0, p999 = 0, max = 0;
+    bool sampled = false;       // false for iterate: one pass, no per-op latency
+    size_t peakRssKb = 0;
+    bench::PerfCounters::Values counts;
+    bool allocTracked = false;
+    bench::alloc::Stats allocs;
+};
+
+// CSV / JSON column names for the counters, in PerfCounters::Counter order.
+const char* kCounterColumns[bench::PerfCounters::kCount] = {
+    "cycles_per_op", "instr_per_op", "br_miss_per_op", "l1d_miss_per_op", "llc_miss_per_op", "dtlb_miss_per_op"};
+
+// ---------------- keys ----------------
+
+uint64_t scramble64(uint64_t x) {
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// i-th distinct key of a distribution. Adversarial int keys share their low
+// bits (bad for identity hashes with power-of-two or small modulo tables);
+// adversarial strings share a long prefix (bad for comparisons and hashing).
+template <class K>
+K makeKey(uint64_t i, Dist d) {
+    if constexpr (std::is_same_v<K, int>) {
+        switch (d) {
+        case Dist::Sequential:  return static_cast<int>(i);
+        case Dist::Adversarial: return static_cast<int>((i * 1024) & 0x7fffffff);
+        default:                return static_cast<int>((static_cast<uint32_t>(i) * 0x9E3779B1u) & 0x7fffffffu);
+        }
+    } else {
+        char buf[96];
+        switch (d) {
+        case Dist::Sequential:
+            std::snprintf(buf, sizeof(buf), "user:%012llu", static_cast<unsigned long long>(i));
+            break;
+        case Dist::Adversarial:
+            std::snprintf(buf, sizeof(buf), "tenant/region/cluster/namespace/service/%llu",
+                          static_cast<unsigned long long>(i));
+            break;
+        default:
+            std::snprintf(buf, sizeof(buf), "user:%016llx", static_cast<unsigned long long>(scramble64(i)));
+            break;
+        }
+        return K(buf);
+    }
+}
+
+// Zipf(theta) ranks over [0, n), after Gray et al. ("Quickly generating
+// billion-record synthetic databases"), as used by YCSB.
+class Zipf {
+    uint64_t n;
+    double theta, alpha, zetan, eta;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> uni{0.0, 1.0};
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+public:
+    Zipf(uint64_t n, double theta, uint64_t seed) : n(n), theta(theta), rng(seed) {
+        zetan = zeta(n, theta);
+        double zeta2 = zeta(2, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1 - std::pow(2.0 / static_cast<double>(n), 1 - theta)) / (1 - zeta2 / zetan);
+    }
+
+    uint64_t next() {
+        double u = uni(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        return static_cast<uint64_t>(static_cast<double>(n) * std::pow(eta * u - eta + 1, alpha)) % n;
+    }
+};
+
+// Picks positions in [0, size) according to the distribution: in order for
+// sequential, skewed (hot ranks scattered over positions) for zipf.
+class Picker {
+    Dist dist;
+    uint64_t counter = 0;
+    std::mt19937_64 rng;
+    std::unique_ptr<Zipf> zipf;
+
+public:
+    Picker(Dist d, size_t n, uint64_t seed) : dist(d), rng(seed) {
+        if (d == Dist::Zipf && n > 1) zipf = std::make_unique<Zipf>(n, 0.99, seed);
+    }
+
+    size_t next(size_t size) {
+        switch (dist) {
+        case Dist::Sequential: return static_cast<size_t>(counter++ % size);
+        case Dist::Zipf:
+            if (zipf) return static_cast<size_t>(scramble64(zipf->next()) % size);
+            [[fallthrough]];
+        default: return static_cast<size_t>(rng() % size);
+        }
+    }
+};
+
+// ---------------- measurement ----------------
+
+class LatencySampler {
+    std::unique_ptr<latency::Histogram> hist = std::make_unique<latency::Histogram>();
+
+public:
+    static constexpr uint64_t kEvery = 8;
+
+    template <class Fn>
+    void run(uint64_t i, Fn&& op) {
+        if (i % kEvery) { op(); return; }
+        uint64_t t0 = latency::now();
+        op();
+        hist->record(latency::now() - t0);
+    }
+
+    void fill(Result& r) {
+        if (!hist->count()) return;
+        r.sampled = true;
+        r.p50 = latency::toNs(hist->percentile(0.50));
+        r.p99 = latency::toNs(hist->percentile(0.99));
+        r.p999 = latency::toNs(hist->percentile(0.999));
+        r.max = latency::toNs(hist->max());
+    }
+};
+
+template <class Engine, class K>
+Result runCase(Dist dist, Workload w, size_t n, uint64_t seed, bool trackAllocs) {
+    Result r;
+    r.n = n;
+    r.ops = n;
+
+    std::vector<K> live(n);
+    for (size_t i = 0; i < n; ++i) live[i] = makeKey<K>(i, dist);
+    uint64_t nextKey = n;                   // keys >= n have never been inserted
+
+    // Opened before the engine so threads it starts (DurableMap's writer
+    // and checkpoints) inherit the counters; start() below resets them.
+    bench::PerfCounters counters;
+    Engine e(2 * n);
+    if (w != Workload::Insert)
+        for (size_t i = 0; i < n; ++i) e.insert(live[i], i);
+
+    std::vector<K> absent;
+    if (w == Workload::LookupMiss) {
+        absent.resize(n);
+        for (size_t i = 0; i < n; ++i) absent[i] = makeKey<K>(n + i, dist);
+    }
+
+    Picker pick(dist, n, seed);
+    std::mt19937_64 rng(seed ^ 0x5bd1e995);
+    LatencySampler lat;
+    size_t found = 0;
+    int readPct = w == Workload::Mixed90 ? 90 : 50;
+    int insertPct = (100 - readPct) / 2;
+
+    std::optional<bench::alloc::Scope> allocScope;
+    if (trackAllocs) allocScope.emplace();
+    counters.start();
+    uint64_t t0 = bench::nowNs();
+    switch (w) {
+    case Workload::Insert:
+        for (size_t i = 0; i < n; ++i) lat.run(i, [&] { e.insert(live[i], i); });
+        break;
+    case Workload::LookupHit:
+        for (size_t i = 0; i < n; ++i) lat.run(i, [&] { found += e.find(live[pick.next(n)]); });
+        break;
+    case Workload::LookupMiss:
+        for (size_t i = 0; i < n; ++i) lat.run(i, [&] { found += e.find(absent[pick.next(n)]); });
+        break;
+    case Workload::EraseChurn:
+        // one op = erase an existing key + insert a fresh one
+        for (size_t i = 0; i < n; ++i) {
+            size_t j = pick.next(n);
+            K fresh = makeKey<K>(nextKey++, dist);
+            lat.run(i, [&] {
+                e.erase(live[j]);
+                e.insert(fresh, i);
+            });
+            live[j] = std::move(fresh);
+        }
+        break;
+    case Workload::Iterate:
+        found += static_cast<size_t>(e.iterate());
+        break;
+    case Workload::Mixed90:
+    case Workload::Mixed50:
+        for (size_t i = 0; i < n; ++i) {
+            int roll = static_cast<int>(rng() % 100);
+            if (roll < readPct || live.empty()) {
+                if (live.empty()) continue;
+                lat.run(i, [&] { found += e.find(live[pick.next(live.size())]); });
+            } else if (roll < readPct + insertPct) {
+                live.push_back(makeKey<K>(nextKey++, dist));
+                lat.run(i, [&] { e.insert(live.back(), i); });
+            } else {
+                size_t j = pick.next(live.size());
+                lat.run(i, [&] { e.erase(live[j]); });
+                live[j] = std::move(live.back());
+                live.pop_back();
+            }
+        }
+        break;
+    }
+    uint64_t t1 = bench::nowNs();
+    r.counts = counters.stop();
+    if (allocScope) {
+        r.allocs = allocScope->stop();
+        r.allocTracked = true;
+    }
+    bench::doNotOptimize(found);
+
+    r.nsPerOp = static_cast<double>(t1 - t0) / static_cast<double>(r.ops);
+    lat.fill(r);
+    r.peakRssKb = bench::peakRssBytes() / 1024;
+    return r;
+}
+
+// ---------------- driver ----------------
+
+struct EngineEntry {
+    const char* key;            // --engines name
+    const char* keyType;
+    const char* name;
+    bool erase;
+    bool quadraticOnSequential;
+    std::function<Result(Dist, Workload, size_t, uint64_t, bool)> run;
+};
+
+template <class Engine, class K>
+EngineEntry entry(const char* key, const char* keyType, bool quadraticOnSequential) {
+    return {key, keyType, Engine::kName, Engine::kErase, quadraticOnSequential,
+            [](Dist d, Workload w, size_t n, uint64_t seed, bool allocs) {
+                return runCase<Engine, K>(d, w, n, seed, allocs);
+            }};
+}
+
+std::vector<EngineEntry> engines() {
+    using namespace adapters;
+    return {
+        entry<FlatEngine<int>, int>("flat", "int", false),
+        entry<SimpleMapEngine<int>, int>("simple", "int", true),
+        entry<OrderedMapEngine<int>, int>("ordered", "int", false),
+        entry<AdaptiveMapEngine<int>, int>("adaptive", "int", false),
+        entry<DurableMapEngine<int>, int>("durable", "int", false),
+        entry<UnorderedMapEngine, int>("unordered", "int", false),
+        entry<EntityManagerEngine, int>("entity", "int", false),
+        entry<FlatEngine<std::string>, std::string>("flat", "string", false),
+        entry<SimpleMapEngine<std::string>, std::string>("simple", "string", true),
+        entry<OrderedMapEngine<std::string>, std::string>("ordered", "string", false),
+        entry<AdaptiveMapEngine<std::string>, std::string>("adaptive", "string", false),
+        entry<DurableMapEngine<std::string>, std::string>("durable", "string", false),
+    };
+}
+
+// allocs/op, requested bytes/op, peak live growth and the non-empty
+// histogram buckets ("le<limit>" / "gt<limit>" in CSV, an object in JSON).
+std::string allocFields(const Result& r, bool json) {
+    if (!r.allocTracked) return json ? "" : ",,,,";
+    const bench::alloc::Stats& a = r.allocs;
+    double ops = static_cast<double>(r.ops ? r.ops : 1);
+    char buf[160];
+    std::snprintf(buf, sizeof(buf),
+                  json ? ",\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.1f,\"peak_live_growth_bytes\":%llu"
+                       : ",%.3f,%.1f,%llu",
+                  static_cast<double>(a.allocs) / ops, static_cast<double>(a.bytes) / ops,
+                  static_cast<unsigned long long>(a.peakLiveGrowth));
+    std::string out = buf;
+    out += json ? ",\"alloc_hist\":{" : ",";
+    bool first = true;
+    for (int b = 0; b < bench::alloc::kBuckets; ++b) {
+        if (!a.hist[b]) continue;
+        bool last = b + 1 == bench::alloc::kBuckets;
+        size_t limit = last ? bench::alloc::bucketLimit(b - 1) : bench::alloc::bucketLimit(b);
+        if (json)
+            std::snprintf(buf, sizeof(buf), "%s\"%s%zu\":%llu", first ? "" : ",", last ? "gt" : "le", limit,
+                          static_cast<unsigned long long>(a.hist[b]));
+        else
+            std::snprintf(buf, sizeof(buf), "%s%s%zu:%llu", first ? "" : ";", last ? "gt" : "le", limit,
+                          static_cast<unsigned long long>(a.hist[b]));
+        out += buf;
+        first = false;
+    }
+    if (json) out += "}";
+    return out;
+}
+
+void printResult(const Result& r, bool json) {
+    char lat[128];
+    std::string counts;
+    for (int c = 0; c < bench::PerfCounters::kCount; ++c) {
+        double v = r.counts.perOp(static_cast<bench::PerfCounters::Counter>(c), r.ops);
+        char field[64];
+        if (json)
+            std::snprintf(field, sizeof(field), v >= 0 ? ",\"%s\":%.3f" : ",\"%s\":null", kCounterColumns[c], v);
+        else if (v >= 0)
+            std::snprintf(field, sizeof(field), ",%.3f", v);
+        else
+            std::snprintf(field, sizeof(field), ",");
+        counts += field;
+    }
+    counts += allocFields(r, json);
+    double mops = r.nsPerOp > 0 ? 1e3 / r.nsPerOp : 0.0;
+    if (json) {
+        if (r.sampled)
+            std::snprintf(lat, sizeof(lat), "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f",
+                          r.p50, r.p99, r.p999, r.max);
+        else
+            std::snprintf(lat, sizeof(lat), "\"p50_ns\":null,\"p99_ns\":null,\"p999_ns\":null,\"max_ns\":null");
+        std::printf("{\"engine\":\"%s\",\"key\":\"%s\",\"dist\":\"%s\",\"workload\":\"%s\",\"n\":%zu,"
+                    "\"ops\":%zu,\"ns_per_op\":%.2f,\"mops\":%.3f,%s,\"peak_rss_kb\":%zu%s}\n",
+                    r.engine.c_str(), r.key.c_str(), r.dist.c_str(), r.workload.c_str(), r.n, r.ops,
+                    r.nsPerOp, mops, lat, r.peakRssKb, counts.c_str());
+    } else {
+        if (r.sampled)
+            std::snprintf(lat, sizeof(lat), "%.0f,%.0f,%.0f,%.0f", r.p50, r.p99, r.p999, r.max);
+        else
+            std::snprintf(lat, sizeof(lat), ",,,");
+        std::printf("%s,%s,%s,%s,%zu,%zu,%.2f,%.3f,%s,%zu%s\n",
+                    r.engine.c_str(), r.key.c_str(), r.dist.c_str(), r.workload.c_str(), r.n, r.ops,
+                    r.nsPerOp, mops, lat, r.peakRssKb, counts.c_str());
+    }
+    std::fflush(stdout);
+}
+
+// Run in a child process where possible, so peak RSS is per case.
+void runIsolated(const std::function<Result()>& fn, bool json, bool useFork) {
+#ifdef MAP_BENCH_HAVE_FORK
+    if (useFork) {
+        std::fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            printResult(fn(), json);
+            std::_Exit(0);
+        }
+        if (pid > 0) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                std::fprintf(stderr, "case failed (status %d)\n", status);
+            return;
+        }
+    }
+#endif
+    (void)useFork;
+    printResult(fn(), json);
+}
+
+std::set<std::string> splitList(const std::string& s) {
+    std::set<std::string> out;
+    std::stringstream ss(s);
+    for (std::string item; std::getline(ss, item, ',');)
+        if (!item.empty()) out.insert(item);
+    return out;
+}
+
+bool selected(const std::set<std::string>& filter, const std::string& name) {
+    return filter.empty() || filter.count(name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            size_t len = std::strlen(prefix);
+            return a.compare(0, len, prefix) == 0 ? argv[i] + len : nullptr;
+        };
+        if (auto v = value("--n=")) opt.n = std::strtoull(v, nullptr, 10);
+        else if (auto v = value("--cap=")) opt.cap = std::strtoull(v, nullptr, 10);
+        else if (auto v = value("--seed=")) opt.seed = std::strtoull(v, nullptr, 10);
+        else if (auto v = value("--engines=")) opt.engines = splitList(v);
+        else if (auto v = value("--workloads=")) opt.workloads = splitList(v);
+        else if (auto v = value("--dists=")) opt.dists = splitList(v);
+        else if (auto v = value("--keys=")) opt.keys = splitList(v);
+        else if (auto v = value("--format=")) opt.json = std::string(v) == "json";
+        else if (a == "--no-fork") opt.fork = false;
+        else if (a == "--alloc") opt.allocs = true;
+        else {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    latency::usingTsc();            // calibrate once, before forking and outside any timed loop
+
+    const Dist dists[] = {Dist::Uniform, Dist::Sequential, Dist::Zipf, Dist::Adversarial};
+    const Workload workloads[] = {Workload::Insert, Workload::LookupHit, Workload::LookupMiss,
+                                  Workload::EraseChurn, Workload::Iterate, Workload::Mixed90,
+                                  Workload::Mixed50};
+
+    if (!opt.json) {
+        std::printf("engine,key,dist,workload,n,ops,ns_per_op,mops,p50_ns,p99_ns,p999_ns,max_ns,peak_rss_kb");
+        for (const char* c : kCounterColumns) std::printf(",%s", c);
+        std::printf(",allocs_per_op,alloc_bytes_per_op,peak_live_growth_bytes,alloc_hist");
+        std::printf("\n");
+    }
+
+    for (auto const& eng : engines()) {
+        if (!selected(opt.engines, eng.key) || !selected(opt.keys, eng.keyType)) continue;
+        for (Dist d : dists) {
+            if (!selected(opt.dists, distName(d))) continue;
+            bool quadratic = d == Dist::Adversarial || (d == Dist::Sequential && eng.quadraticOnSequential);
+            size_t n = quadratic ? std::min(opt.n, opt.cap) : opt.n;
+            for (Workload w : workloads) {
+                if (!selected(opt.workloads, workloadName(w))) continue;
+                bool needsErase = w == Workload::EraseChurn || w == Workload::Mixed90 || w == Workload::Mixed50;
+                if (needsErase && !eng.erase) continue;
+                runIsolated([&] {
+                    Result r = eng.run(d, w, n, opt.seed, opt.allocs);
+                    r.engine = eng.name;
+                    r.key = eng.keyType;
+                    r.dist = distName(d);
+                    r.workload = workloadName(w);
+                    return r;
+                }, opt.json, opt.fork);
+            }
+        }
+    }
+}
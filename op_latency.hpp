@@ -0,0 +1,330 @@
+#pragma once
+// Opt-in per-operation latency instrumentation for the map containers.
+//
+//   latency::Timed timed(map);              // borrows any of the maps
+//   timed.insert_or_assign(k, v);           // forwarded and timed
+//   ...
+//   latency::global().report(stdout);       // p50 / p99 / p99.9 / max per op
+//
+// Each call is timed with the TSC (rdtsc, fenced) where it is invariant,
+// else steady_clock, and recorded into a log-linear (HDR-style) histogram:
+// 64 linear sub-buckets per power of two, so a reported percentile is
+// within ~1.6% of the true value; the max is exact. Every thread records
+// into its own histograms, registered once; counts are single-writer
+// relaxed atomics, so recording takes no lock and report() can run while
+// other threads record. Containers not wrapped pay nothing.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define LATENCY_HAVE_TSC 1
+#endif
+
+namespace latency {
+
+// ---------------- clock ----------------
+
+namespace detail {
+
+inline uint64_t steadyNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline bool invariantTsc() {
+#ifdef LATENCY_HAVE_TSC
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000000u, &a, &b, &c, &d) || a < 0x80000007u) return false;
+    __get_cpuid(0x80000007u, &a, &b, &c, &d);
+    return (d >> 8) & 1;
+#else
+    return false;
+#endif
+}
+
+struct ClockInfo {
+    bool tsc = false;
+    double nsPerTick = 1.0;
+
+    ClockInfo() {
+#ifdef LATENCY_HAVE_TSC
+        if (!invariantTsc()) return;
+        // Calibrate against steady_clock over ~10 ms.
+        uint64_t n0 = steadyNs(), t0 = __rdtsc();
+        while (steadyNs() - n0 < 10'000'000) {}
+        uint64_t n1 = steadyNs(), t1 = __rdtsc();
+        if (t1 <= t0) return;
+        tsc = true;
+        nsPerTick = static_cast<double>(n1 - n0) / static_cast<double>(t1 - t0);
+#endif
+    }
+};
+
+inline const ClockInfo& clockInfo() {
+    static const ClockInfo info;
+    return info;
+}
+
+} // namespace detail
+
+// Timestamp in ticks; convert differences with toNs().
+inline uint64_t now() {
+#ifdef LATENCY_HAVE_TSC
+    if (detail::clockInfo().tsc) {
+        _mm_lfence();               // do not start before earlier work retires
+        uint64_t t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+#endif
+    return detail::steadyNs();
+}
+
+inline double toNs(uint64_t ticks) { return static_cast<double>(ticks) * detail::clockInfo().nsPerTick; }
+
+inline bool usingTsc() { return detail::clockInfo().tsc; }
+
+// ---------------- histogram ----------------
+
+// Log-linear histogram of tick counts. Values below 128 have their own
+// bucket; above, each power of two is split into 64 buckets. Values past
+// 2^40 ticks land in the last bucket (max stays exact).
+class Histogram {
+public:
+    static constexpr int kSubBits = 7;
+    static constexpr int kHalf = 1 << (kSubBits - 1);
+    static constexpr int kMaxBits = 40;
+    static constexpr int kBuckets = (kMaxBits - kSubBits + 2) * kHalf;
+
+    static int indexOf(uint64_t v) {
+        if (v < (uint64_t(1) << kSubBits)) return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits + 1;
+        int idx = shift * kHalf + static_cast<int>(v >> shift);
+        return idx < kBuckets ? idx : kBuckets - 1;
+    }
+
+    // Largest value that maps to bucket idx.
+    static uint64_t upperOf(int idx) {
+        if (idx < 2 * kHalf) return static_cast<uint64_t>(idx);
+        int shift = idx / kHalf - 1;
+        uint64_t sub = static_cast<uint64_t>(idx - shift * kHalf);
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> counts[kBuckets] = {};
+    std::atomic<uint64_t> total{0}, maxValue{0};
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t by) {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+public:
+    // Single writer: only the owning thread records.
+    void record(uint64_t v) {
+        bump(counts[indexOf(v)], 1);
+        bump(total, 1);
+        if (v > maxValue.load(std::memory_order_relaxed)) maxValue.store(v, std::memory_order_relaxed);
+    }
+
+    // Not synchronised with record(); callers merge into a private copy.
+    void add(const Histogram& other) {
+        for (int i = 0; i < kBuckets; ++i) bump(counts[i], other.counts[i].load(std::memory_order_relaxed));
+        bump(total, other.total.load(std::memory_order_relaxed));
+        uint64_t m = other.maxValue.load(std::memory_order_relaxed);
+        if (m > maxValue.load(std::memory_order_relaxed)) maxValue.store(m, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+
+    // Value at quantile q in [0, 1], as the upper edge of its bucket.
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if (!n) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(n));
+        if (rank >= n) rank = n - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen > rank) return std::min(upperOf(i), max());
+        }
+        return max();
+    }
+};
+
+// ---------------- per-thread recorder ----------------
+
+enum class Op { Insert, Find, Erase, Iterate, kCount };
+
+inline const char* opName(Op op) {
+    static const char* kNames[] = {"insert", "find", "erase", "iterate"};
+    return kNames[static_cast<int>(op)];
+}
+
+class Recorder {
+    struct PerThread {
+        std::thread::id owner;
+        Histogram ops[static_cast<int>(Op::kCount)];
+    };
+
+    std::mutex mutex;                               // registration and reads only
+    std::vector<std::unique_ptr<PerThread>> threads; // outlive their threads
+    const uint64_t id;                              // unique per recorder, for the thread cache
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> ids{1};
+        return ids.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The calling thread's block, registered on first use. A one-entry
+    // thread-local cache keeps the common case (one recorder) lock-free.
+    PerThread& local() {
+        thread_local uint64_t cachedId = 0;
+        thread_local PerThread* cached = nullptr;
+        if (cachedId == id) return *cached;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto self = std::this_thread::get_id();
+        PerThread* mine = nullptr;
+        for (auto const& t : threads)
+            if (t->owner == self) mine = t.get();
+        if (!mine) {
+            threads.push_back(std::make_unique<PerThread>());
+            mine = threads.back().get();
+            mine->owner = self;
+        }
+        cachedId = id;
+        cached = mine;
+        return *mine;
+    }
+
+public:
+    Recorder() : id(nextId()) {}
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    void record(Op op, uint64_t ticks) { local().ops[static_cast<int>(op)].record(ticks); }
+
+    // All threads' histograms for one op, merged.
+    std::unique_ptr<Histogram> merged(Op op) {
+        auto out = std::make_unique<Histogram>();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto const& t : threads) out->add(t->ops[static_cast<int>(op)]);
+        return out;
+    }
+
+    // Only while no thread is recording.
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto const& t : threads)
+            for (auto& h : t->ops) h.reset();
+    }
+
+    void report(std::FILE* out) {
+        std::fprintf(out, "%-8s %12s %10s %10s %10s %12s   (ns, %s)\n", "op", "count", "p50", "p99", "p99.9",
+                     "max", usingTsc() ? "tsc" : "steady_clock");
+        for (int i = 0; i < static_cast<int>(Op::kCount); ++i) {
+            auto h = merged(static_cast<Op>(i));
+            if (!h->count()) continue;
+            std::fprintf(out, "%-8s %12llu %10.0f %10.0f %10.0f %12.0f\n", opName(static_cast<Op>(i)),
+                         static_cast<unsigned long long>(h->count()), toNs(h->percentile(0.50)),
+                         toNs(h->percentile(0.99)), toNs(h->percentile(0.999)), toNs(h->max()));
+        }
+    }
+};
+
+inline Recorder& global() {
+    static Recorder recorder;
+    return recorder;
+}
+
+// ---------------- container wrapper ----------------
+
+// Forwards calls to a borrowed container and times each one into a
+// Recorder. Only the operations the wrapped container has are available.
+template <class Map>
+class Timed {
+    Map& map;
+    Recorder& rec;
+
+    template <class Fn>
+    decltype(auto) timed(Op op, Fn&& fn) {
+        struct Stop {
+            Recorder& rec;
+            Op op;
+            uint64_t t0;
+            ~Stop() { rec.record(op, now() - t0); }
+        } stop{rec, op, now()};
+        return fn();
+    }
+
+public:
+    explicit Timed(Map& map, Recorder& rec = global()) : map(map), rec(rec) {}
+
+    Map& underlying() { return map; }
+
+    // flat_unordered_map
+    template <class K, class V>
+        requires requires(Map& m, K&& k, V&& v) { m.insert_or_assign(std::forward<K>(k), std::forward<V>(v)); }
+    auto insert_or_assign(K&& key, V&& value) {
+        return timed(Op::Insert, [&] { return map.insert_or_assign(std::forward<K>(key), std::forward<V>(value)); });
+    }
+
+    // SimpleMap, UnorderedMap
+    template <class K, class V>
+        requires requires(Map& m, const K& k, const V& v) { m.insert(k, v); }
+    void insert(const K& key, const V& value) {
+        timed(Op::Insert, [&] { map.insert(key, value); });
+    }
+
+    template <class K>
+        requires requires(Map& m, const K& k) { m.find(k); }
+    auto find(const K& key) {
+        return timed(Op::Find, [&] { return map.find(key); });
+    }
+
+    template <class K>
+        requires requires(Map& m, const K& k) { m.erase(k); }
+    auto erase(const K& key) {
+        return timed(Op::Erase, [&] { return map.erase(key); });
+    }
+
+    template <class Fn>
+        requires requires(Map& m, Fn&& fn) { m.for_each(std::forward<Fn>(fn)); }
+    void for_each(Fn&& fn) {
+        timed(Op::Iterate, [&] { map.for_each(std::forward<Fn>(fn)); });
+    }
+
+    template <class Fn>
+        requires requires(Map& m, Fn&& fn) { m.forEach(std::forward<Fn>(fn)); }
+    void forEach(Fn&& fn) {
+        timed(Op::Iterate, [&] { map.forEach(std::forward<Fn>(fn)); });
+    }
+
+    auto size() const
+        requires requires(const Map& m) { m.size(); }
+    {
+        return map.size();
+    }
+};
+
+} // namespace latency
@@ -0,0 +1,145 @@
+// Wraps each map container in latency::Timed (op_latency.hpp), runs a
+// fixed mix of operations and checks that every call landed in its op's
+// histogram.
+//
+//   g++ -std=c++20 -O2 -pthread op_latency_demo.cpp -o op_latency_demo
+//   ./op_latency_demo [n]                  (default: 10000)
+//
+// Each container gets n inserts, 2n finds (half of them misses), n / 2
+// erases where it has erase, and one iteration; a last case has two
+// threads record into one Recorder. The p50 / p99 / p99.9 / max table of
+// every case is printed. Exits non-zero if a histogram count differs from
+// the calls made or a result is wrong.
+
+#define SIMPLE_MAPS_NO_MAIN
+#include "flat_buffered_unordered_map.cpp"
+#include "map.cpp"
+#include "unordered_map.cpp"
+#undef SIMPLE_MAPS_NO_MAIN
+#include "op_latency.hpp"
+
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using latency::Op;
+
+struct Counts {
+    uint64_t ops[static_cast<int>(Op::kCount)] = {};
+
+    uint64_t& operator[](Op op) { return ops[static_cast<int>(op)]; }
+};
+
+bool countsMatch(latency::Recorder& rec, Counts want) {
+    bool ok = true;
+    for (int i = 0; i < static_cast<int>(Op::kCount); ++i) {
+        uint64_t got = rec.merged(static_cast<Op>(i))->count();
+        if (got != want.ops[i]) {
+            std::printf("  %s: %llu recorded, %llu made\n", latency::opName(static_cast<Op>(i)),
+                        static_cast<unsigned long long>(got), static_cast<unsigned long long>(want.ops[i]));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+std::vector<int> shuffledKeys(size_t n) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(n));
+    return keys;
+}
+
+// Inserts keys [0, n), finds [0, 2n), erases the even keys if it can and
+// iterates once, through `timed`. `want` receives the calls made.
+template <class Timed, class Value>
+bool exercise(Timed& timed, size_t n, Value (*makeValue)(int), Counts& want) {
+    bool ok = true;
+    for (int k : shuffledKeys(n)) {
+        if constexpr (requires { timed.insert_or_assign(k, makeValue(k)); }) timed.insert_or_assign(k, makeValue(k));
+        else timed.insert(k, makeValue(k));
+        ++want[Op::Insert];
+    }
+
+    size_t hits = 0;
+    for (int k : shuffledKeys(2 * n)) {
+        hits += timed.find(k) != nullptr;
+        ++want[Op::Find];
+    }
+    ok = ok && hits == n;
+
+    size_t live = n;
+    if constexpr (requires(int k) { timed.erase(k); }) {
+        for (int k = 0; k < static_cast<int>(n); k += 2) {
+            timed.erase(k);
+            ++want[Op::Erase];
+            --live;
+        }
+    }
+
+    size_t visited = 0;
+    auto visit = [&](auto const&, auto const&) { ++visited; };
+    if constexpr (requires { timed.for_each(visit); }) timed.for_each(visit);
+    else timed.forEach(visit);
+    ++want[Op::Iterate];
+    return ok && visited == live;
+}
+
+uint64_t intValue(int k) { return static_cast<uint64_t>(k) * 3; }
+std::string stringValue(int k) { return "v" + std::to_string(k); }
+
+template <class Map, class Value>
+bool run(const char* name, size_t n, Value (*makeValue)(int)) {
+    Map map;
+    latency::Recorder rec;
+    latency::Timed timed(map, rec);
+    Counts want;
+    bool ok = exercise(timed, n, makeValue, want);
+    ok = countsMatch(rec, want) && ok;
+    std::printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+    rec.report(stdout);
+    std::printf("\n");
+    return ok;
+}
+
+// Two threads, each with its own map, recording into one Recorder.
+bool runThreads(size_t n) {
+    latency::Recorder rec;
+    Counts want[2];
+    bool ok[2] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&, t] {
+            flat_unordered_map<int, uint64_t> map;
+            latency::Timed timed(map, rec);
+            ok[t] = exercise(timed, n, intValue, want[t]);
+        });
+    }
+    for (auto& t : threads) t.join();
+    Counts total;
+    for (int i = 0; i < static_cast<int>(Op::kCount); ++i) total.ops[i] = want[0].ops[i] + want[1].ops[i];
+    bool good = countsMatch(rec, total) && ok[0] && ok[1];
+    std::printf("2 threads, flat_unordered_map: %s\n", good ? "ok" : "FAILED");
+    rec.report(stdout);
+    return good;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    if (n == 0) n = 10000;
+
+    bool ok = true;
+    ok = run<flat_unordered_map<int, uint64_t>>("flat_unordered_map", n, intValue) && ok;
+    ok = run<SimpleMap<int, uint64_t>>("SimpleMap", n, intValue) && ok;
+    ok = run<OrderedMap<int, uint64_t>>("OrderedMap", n, intValue) && ok;
+    ok = run<UnorderedMap>("UnorderedMap", n, stringValue) && ok;
+    ok = runThreads(n) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+#pragma once
+// Operation traces for the map containers: a compact binary stream of
+// (op, key, value size) records, a wrapper that records every call made on
+// a flat_unordered_map, UnorderedMap or SimpleMap, and a reader that
+// decodes a trace for replay (see trace_replay.cpp).
+//
+// Recording in production:
+//
+//   flat_unordered_map<std::string, Session> sessions;
+//   trace::Writer writer("sessions.trace", trace::KeyKind::String);
+//   trace::Recorded rec(sessions, writer);
+//   rec.insert_or_assign(id, s);       // forwarded and recorded
+//   if (auto* s = rec.find(id)) ...
+//
+// Format (little endian, varints are LEB128):
+//
+//   header   "MTRC" u8 version u8 keyKind u16 reserved
+//   record   u8 tag | key | [varint valueSize]
+//     tag    bits 0-1 op (insert, find, erase, iterate)
+//            bit 2    result recorded, bit 3 result (new key / hit / erased)
+//     key    int keys:    zigzag varint of the delta to the previous int key
+//            string keys: varint length, bytes
+//            iterate records have no key
+//     valueSize only on inserts: size() for sized values, else sizeof
+//
+// Sequential and clustered ids encode in one or two bytes per key.
+
+#include "varint.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace trace {
+
+enum class Op : uint8_t { Insert = 0, Find = 1, Erase = 2, Iterate = 3 };
+enum class KeyKind : uint8_t { Int = 0, String = 1 };
+
+inline constexpr char kMagic[4] = {'M', 'T', 'R', 'C'};
+inline constexpr uint8_t kVersion = 1;
+
+inline constexpr uint8_t kOpMask = 0x3;
+inline constexpr uint8_t kHasResult = 0x4;
+inline constexpr uint8_t kResult = 0x8;
+
+// Buffered trace output. Not thread-safe, like the containers it records.
+// A failed write (full disk, say) closes the file and stops recording;
+// ok() then stays false, so check it after close() before trusting the
+// trace.
+class Writer {
+    std::FILE* file = nullptr;
+    KeyKind kind;
+    std::vector<uint8_t> buf;
+    int64_t prevKey = 0;
+    uint64_t records = 0;
+    bool failed = false;
+
+    static constexpr size_t kFlushBytes = 64 * 1024;
+
+    void begin(Op op, int result) {
+        uint8_t tag = static_cast<uint8_t>(op);
+        if (result >= 0) tag |= kHasResult | (result ? kResult : 0);
+        buf.push_back(tag);
+        ++records;
+    }
+
+    void end() {
+        if (buf.size() >= kFlushBytes) flush();
+    }
+
+    void fail() {
+        std::fclose(file);
+        file = nullptr;
+        failed = true;
+        buf.clear();
+    }
+
+public:
+    Writer(const char* path, KeyKind kind) : kind(kind) {
+        file = std::fopen(path, "wb");
+        if (!file) {
+            failed = true;
+            return;
+        }
+        uint8_t header[8] = {uint8_t(kMagic[0]), uint8_t(kMagic[1]), uint8_t(kMagic[2]), uint8_t(kMagic[3]),
+                             kVersion, static_cast<uint8_t>(kind), 0, 0};
+        if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header)) fail();
+        buf.reserve(kFlushBytes + 256);
+    }
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer() { close(); }
+
+    // False if the file could not be opened, written or closed.
+    bool ok() const { return !failed; }
+    KeyKind keyKind() const { return kind; }
+    uint64_t recordCount() const { return records; }
+
+    bool flush() {
+        if (file && !buf.empty() && std::fwrite(buf.data(), 1, buf.size(), file) != buf.size()) fail();
+        buf.clear();
+        return !failed;
+    }
+
+    // Flushes and closes; false if any write since opening failed.
+    bool close() {
+        if (!file) return !failed;
+        if (!flush()) return false;
+        if (std::fclose(file) != 0) failed = true;
+        file = nullptr;
+        return !failed;
+    }
+
+    // result: -1 when the container does not report one, else 0 / 1.
+    void record(Op op, int64_t key, uint64_t valueSize = 0, int result = -1) {
+        if (!file) return;
+        begin(op, result);
+        if (op != Op::Iterate) {
+            // Wrapping difference: keys far apart would overflow int64.
+            putVarint(buf, zigzag64(static_cast<int64_t>(uint64_t(key) - uint64_t(prevKey))));
+            prevKey = key;
+        }
+        if (op == Op::Insert) putVarint(buf, valueSize);
+        end();
+    }
+
+    void record(Op op, std::string_view key, uint64_t valueSize = 0, int result = -1) {
+        if (!file) return;
+        begin(op, result);
+        if (op != Op::Iterate) {
+            putVarint(buf, key.size());
+            buf.insert(buf.end(), key.begin(), key.end());
+        }
+        if (op == Op::Insert) putVarint(buf, valueSize);
+        end();
+    }
+
+    void recordIterate() {
+        if (!file) return;
+        begin(Op::Iterate, -1);
+        end();
+    }
+};
+
+template <class V>
+uint64_t valueSize(const V& v) {
+    if constexpr (requires { v.size(); }) return static_cast<uint64_t>(v.size());
+    else return sizeof(V);
+}
+
+// Forwards calls to a borrowed container and records each one. Only the
+// operations the wrapped container has are available.
+template <class Map>
+class Recorded {
+    Map& map;
+    Writer& out;
+
+    template <class K>
+    void log(Op op, const K& key, uint64_t valueSize, int result) {
+        if constexpr (std::is_integral_v<K>) out.record(op, static_cast<int64_t>(key), valueSize, result);
+        else out.record(op, std::string_view(key), valueSize, result);
+    }
+
+public:
+    Recorded(Map& map, Writer& out) : map(map), out(out) {}
+
+    Map& underlying() { return map; }
+
+    // flat_unordered_map
+    template <class K, class V>
+        requires requires(Map& m, const K& k, V&& v) { m.insert_or_assign(k, std::forward<V>(v)); }
+    auto insert_or_assign(const K& key, V&& value) {
+        uint64_t size = valueSize(value);
+        auto r = map.insert_or_assign(key, std::forward<V>(value));
+        log(Op::Insert, key, size, r.first ? 1 : 0);
+        return r;
+    }
+
+    // SimpleMap, UnorderedMap
+    template <class K, class V>
+        requires requires(Map& m, const K& k, const V& v) { m.insert(k, v); }
+    void insert(const K& key, const V& value) {
+        log(Op::Insert, key, valueSize(value), -1);
+        map.insert(key, value);
+    }
+
+    template <class K>
+        requires requires(Map& m, const K& k) { m.find(k); }
+    auto find(const K& key) {
+        auto r = map.find(key);
+        log(Op::Find, key, 0, r != nullptr);
+        return r;
+    }
+
+    template <class K>
+        requires requires(Map& m, const K& k) { m.erase(k); }
+    auto erase(const K& key) {
+        if constexpr (std::is_void_v<decltype(map.erase(key))>) {
+            log(Op::Erase, key, 0, -1);
+            map.erase(key);
+        } else {
+            auto r = map.erase(key);
+            log(Op::Erase, key, 0, r ? 1 : 0);
+            return r;
+        }
+    }
+
+    template <class Fn>
+        requires requires(Map& m, Fn&& fn) { m.for_each(std::forward<Fn>(fn)); }
+    void for_each(Fn&& fn) {
+        out.recordIterate();
+        map.for_each(std::forward<Fn>(fn));
+    }
+
+    template <class Fn>
+        requires requires(Map& m, Fn&& fn) { m.forEach(std::forward<Fn>(fn)); }
+    void forEach(Fn&& fn) {
+        out.recordIterate();
+        map.forEach(std::forward<Fn>(fn));
+    }
+
+    auto size() const
+        requires requires(const Map& m) { m.size(); }
+    {
+        return map.size();
+    }
+};
+
+// Decoded trace, held in memory so replay timing excludes parsing.
+struct Record {
+    Op op;
+    int8_t result;              // -1 unknown, else 0 / 1
+    uint32_t valueSize;
+    int64_t key;                // int traces: the key; string traces: offset into Trace::strings
+    uint32_t keyLen;            // string traces only
+};
+
+struct Trace {
+    KeyKind kind = KeyKind::Int;
+    std::vector<Record> records;
+    std::string strings;
+
+    std::string_view stringKey(const Record& r) const {
+        return std::string_view(strings).substr(static_cast<size_t>(r.key), r.keyLen);
+    }
+};
+
+// Reads a whole trace file. Returns false on I/O errors, a bad header or
+// a truncated record; records decoded up to that point are kept.
+inline bool readTrace(const char* path, Trace& t, std::string* error = nullptr) {
+    auto fail = [&](const char* msg) {
+        if (error) *error = msg;
+        return false;
+    };
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return fail("cannot open trace");
+    std::vector<uint8_t> data;
+    uint8_t chunk[1 << 16];
+    for (size_t got; (got = std::fread(chunk, 1, sizeof(chunk), f)) > 0;)
+        data.insert(data.end(), chunk, chunk + got);
+    std::fclose(f);
+
+    if (data.size() < 8 || std::string_view(reinterpret_cast<const char*>(data.data()), 4) != std::string_view(kMagic, 4))
+        return fail("not a trace file");
+    if (data[4] != kVersion) return fail("unsupported trace version");
+    if (data[5] > static_cast<uint8_t>(KeyKind::String)) return fail("unknown key kind");
+    t.kind = static_cast<KeyKind>(data[5]);
+    t.records.clear();
+    t.strings.clear();
+
+    const uint8_t* p = data.data() + 8;
+    const uint8_t* end = data.data() + data.size();
+    int64_t prevKey = 0;
+    while (p < end) {
+        uint8_t tag = *p++;
+        Record r{static_cast<Op>(tag & kOpMask), int8_t(tag & kHasResult ? (tag & kResult ? 1 : 0) : -1), 0, 0, 0};
+        uint64_t v = 0;
+        if (r.op != Op::Iterate) {
+            if (!getVarint(p, end, v)) return fail("truncated record");
+            if (t.kind == KeyKind::Int) {
+                prevKey = static_cast<int64_t>(uint64_t(prevKey) + uint64_t(unzigzag64(v)));
+                r.key = prevKey;
+            } else {
+                if (v > uint64_t(end - p)) return fail("truncated record");
+                r.key = static_cast<int64_t>(t.strings.size());
+                r.keyLen = static_cast<uint32_t>(v);
+                t.strings.append(reinterpret_cast<const char*>(p), static_cast<size_t>(v));
+                p += v;
+            }
+        }
+        if (r.op == Op::Insert) {
+            if (!getVarint(p, end, v)) return fail("truncated record");
+            r.valueSize = static_cast<uint32_t>(v);
+        }
+        t.records.push_back(r);
+    }
+    return true;
+}
+
+} // namespace trace
@@ -0,0 +1,155 @@
+// Records a fixed workload through trace::Recorded (op_trace.hpp) on each
+// map container, reads the trace back with readTrace and checks it
+// against the calls made.
+//
+//   g++ -std=c++20 -O2 -pthread op_trace_demo.cpp -o op_trace_demo
+//   ./op_trace_demo [file]              (default: ./op_trace_demo.trace)
+//
+// Every case writes `file`, so it must be somewhere writable; it is
+// removed at the end. Each record must come back with the op, key, value
+// size and result of its call, in order. Exits non-zero on any difference.
+
+#define SIMPLE_MAPS_NO_MAIN
+#include "flat_buffered_unordered_map.cpp"
+#include "map.cpp"
+#include "unordered_map.cpp"
+#undef SIMPLE_MAPS_NO_MAIN
+#include "op_trace.hpp"
+
+#include <climits>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// What a call should have recorded. Int traces use `key`, string traces
+// `text`.
+struct Expect {
+    trace::Op op;
+    int result;
+    uint64_t valueSize;
+    int64_t key = 0;
+    std::string text;
+};
+
+template <class K>
+void expect(std::vector<Expect>& out, trace::Op op, const K& key, uint64_t valueSize, int result) {
+    Expect e{op, result, valueSize, 0, {}};
+    if constexpr (std::is_integral_v<K>) e.key = key;
+    else e.text = key;
+    out.push_back(std::move(e));
+}
+
+bool matches(const trace::Trace& t, const std::vector<Expect>& want) {
+    if (t.records.size() != want.size()) return false;
+    for (size_t i = 0; i < want.size(); ++i) {
+        const trace::Record& r = t.records[i];
+        const Expect& e = want[i];
+        if (r.op != e.op || r.result != e.result || r.valueSize != e.valueSize) return false;
+        if (e.op == trace::Op::Iterate) continue;
+        if (t.kind == trace::KeyKind::Int ? r.key != e.key : t.stringKey(r) != e.text) return false;
+    }
+    return true;
+}
+
+int intKey(int i) { return i * 7 - 300; }
+std::string stringKey(int i) { return "user:" + std::to_string(i * 7); }
+
+// Inserts, finds (hits and misses), erases where the map has erase, and
+// iterates, through a Recorded wrapper; `want` gets what each call should
+// have recorded.
+template <class Map, class K, class V>
+void workload(Map& map, trace::Writer& out, K (*key)(int), V (*value)(int), std::vector<Expect>& want) {
+    trace::Recorded rec(map, out);
+    for (int i = 0; i < 200; ++i) {
+        V v = value(i);
+        uint64_t size = trace::valueSize(v);
+        if constexpr (requires { rec.insert_or_assign(key(i), v); }) {
+            bool inserted = rec.insert_or_assign(key(i), v).first;
+            expect(want, trace::Op::Insert, key(i), size, inserted ? 1 : 0);
+        } else {
+            rec.insert(key(i), v);
+            expect(want, trace::Op::Insert, key(i), size, -1);
+        }
+    }
+    for (int i = 150; i < 250; ++i) {
+        bool hit = rec.find(key(i)) != nullptr;
+        expect(want, trace::Op::Find, key(i), 0, hit ? 1 : 0);
+    }
+    if constexpr (requires { rec.erase(key(0)); }) {
+        for (int i = 0; i < 260; i += 13) {
+            if constexpr (std::is_void_v<decltype(rec.erase(key(i)))>) {
+                rec.erase(key(i));
+                expect(want, trace::Op::Erase, key(i), 0, -1);
+            } else {
+                bool erased = rec.erase(key(i));
+                expect(want, trace::Op::Erase, key(i), 0, erased ? 1 : 0);
+            }
+        }
+    }
+    auto visit = [](auto const&, auto const&) {};
+    if constexpr (requires { rec.for_each(visit); }) rec.for_each(visit);
+    else rec.forEach(visit);
+    expect(want, trace::Op::Iterate, K{}, 0, -1);
+}
+
+template <class Map, class K, class V>
+bool run(const char* name, const char* path, K (*key)(int), V (*value)(int)) {
+    constexpr trace::KeyKind kind = std::is_integral_v<K> ? trace::KeyKind::Int : trace::KeyKind::String;
+    std::vector<Expect> want;
+    bool ok;
+    {
+        Map map;
+        trace::Writer out(path, kind);
+        workload(map, out, key, value, want);
+        ok = out.close() && out.recordCount() == want.size();
+    }
+    trace::Trace t;
+    std::string error;
+    if (ok && !trace::readTrace(path, t, &error)) {
+        std::printf("%s: %s\n", name, error.c_str());
+        ok = false;
+    }
+    ok = ok && t.kind == kind && matches(t, want);
+    std::printf("%-32s %zu records %s\n", name, want.size(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Keys at both ends of int64: the deltas between them wrap.
+bool runExtremes(const char* path) {
+    const int64_t keys[] = {0, INT64_MAX, INT64_MIN, -1, INT64_MIN, INT64_MAX, 42};
+    {
+        trace::Writer out(path, trace::KeyKind::Int);
+        for (int64_t k : keys) out.record(trace::Op::Find, k, 0, 1);
+        if (!out.close()) return false;
+    }
+    trace::Trace t;
+    bool ok = trace::readTrace(path, t) && t.records.size() == std::size(keys);
+    for (size_t i = 0; ok && i < std::size(keys); ++i) ok = t.records[i].key == keys[i];
+    std::printf("%-32s %zu records %s\n", "int64 extremes", std::size(keys), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+uint64_t intValue(int i) { return static_cast<uint64_t>(i); }
+std::string stringValue(int i) { return std::string(static_cast<size_t>(i % 40), 'x'); }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "op_trace_demo.trace";
+
+    bool ok = true;
+    ok = run<flat_unordered_map<int, uint64_t>>("flat_unordered_map<int>", path, intKey, intValue) && ok;
+    ok = run<flat_unordered_map<std::string, std::string>>("flat_unordered_map<string>", path, stringKey,
+                                                          stringValue) && ok;
+    ok = run<SimpleMap<int, uint64_t>>("SimpleMap<int>", path, intKey, intValue) && ok;
+    ok = run<SimpleMap<std::string, uint64_t>>("SimpleMap<string>", path, stringKey, intValue) && ok;
+    ok = run<OrderedMap<int, std::string>>("OrderedMap<int>", path, intKey, stringValue) && ok;
+    ok = run<UnorderedMap>("UnorderedMap", path, intKey, stringValue) && ok;
+    ok = runExtremes(path) && ok;
+    std::remove(path);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Benchmarks for the query operators built on the hash tables.
+//
+//   g++ -std=c++20 -O2 -pthread query_bench.cpp -o query_bench
+//   ./query_bench [n ...]                  (default: 100000 1000000 10000000)
+//
+// join: an equi-join of n build rows (about 4 rows per key) against n probe
+// keys, half of which match. The baseline is the usual
+// flat_unordered_map<Key, std::vector<Row>>; JoinTable (hash_join.hpp) is
+// built single-threaded and on a ThreadPool.
+//
+// group-by: a sum over n rows into n / 16 groups. The baseline is
+// `map[key] += value` on flat_unordered_map; AggregateTable (group_by.hpp)
+// runs single-threaded, with a memory budget of a quarter of its unbounded
+// footprint (so it spills), and with per-thread pre-aggregation on a pool.
+//
+// Reports ns per input row (for the join: per build row and per probe key).
+
+#define SIMPLE_MAPS_NO_MAIN
+#include "flat_buffered_unordered_map.cpp"
+#undef SIMPLE_MAPS_NO_MAIN
+
+#include "bench_util.hpp"
+#include "group_by.hpp"
+#include "hash_join.hpp"
+
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+struct Row {
+    uint64_t payload;
+    uint32_t extra;
+};
+
+void printHeader() {
+    std::printf("%-10s %-22s %12s %10s %9s\n", "operator", "variant", "n", "ns/row", "Mrows/s");
+}
+
+template <class Fn>
+void measure(const char* op, const char* variant, size_t n, Fn&& body) {
+    uint64_t t0 = bench::nowNs();
+    body();
+    double perRow = n ? static_cast<double>(bench::nowNs() - t0) / static_cast<double>(n) : 0.0;
+    std::printf("%-10s %-22s %12zu %10.1f %9.2f\n", op, variant, n, perRow, perRow > 0 ? 1e3 / perRow : 0.0);
+}
+
+void benchJoin(size_t n, ThreadPool& pool) {
+    std::mt19937_64 rng(11);
+    const size_t distinct = std::max<size_t>(n / 4, 1);
+    std::vector<int> buildKeys(n), probeKeys(n);
+    std::vector<Row> rows(n);
+    for (size_t i = 0; i < n; ++i) {
+        buildKeys[i] = static_cast<int>(rng() % distinct);
+        rows[i] = {rng(), static_cast<uint32_t>(i)};
+    }
+    // Half the probe keys fall outside the build key range.
+    for (size_t i = 0; i < n; ++i) probeKeys[i] = static_cast<int>(rng() % (2 * distinct));
+
+    {
+        flat_unordered_map<int, std::vector<Row>> m;
+        measure("join", "vector-per-key build", n, [&] {
+            for (size_t i = 0; i < n; ++i) m[buildKeys[i]].push_back(rows[i]);
+        });
+        measure("join", "vector-per-key probe", n, [&] {
+            uint64_t sum = 0;
+            for (int k : probeKeys)
+                if (auto* v = m.find(k))
+                    for (const Row& r : *v) sum += r.payload;
+            bench::doNotOptimize(sum);
+        });
+    }
+    for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        JoinTable<int, Row> t;
+        measure("join", p ? "JoinTable build (pool)" : "JoinTable build", n, [&] { t.build(buildKeys, rows, p); });
+        if (p) continue;
+        measure("join", "JoinTable probe", n, [&] {
+            uint64_t sum = 0;
+            t.probe(probeKeys, [&](size_t, std::span<const Row> matches) {
+                for (const Row& r : matches) sum += r.payload;
+            });
+            bench::doNotOptimize(sum);
+        });
+    }
+}
+
+void benchGroupBy(size_t n, ThreadPool& pool) {
+    std::mt19937_64 rng(13);
+    const size_t groups = std::max<size_t>(n / 16, 1);
+    std::vector<int> keys(n);
+    std::vector<int64_t> values(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = static_cast<int>(rng() % groups);
+        values[i] = static_cast<int64_t>(rng() % 1000);
+    }
+    auto checksum = [](const int&, const agg::Group<int64_t>& g) { bench::doNotOptimize(g.value); };
+
+    {
+        flat_unordered_map<int, int64_t> m;
+        measure("group-by", "flat operator[]", n, [&] {
+            for (size_t i = 0; i < n; ++i) m[keys[i]] += values[i];
+        });
+    }
+    size_t footprint = 0;
+    {
+        AggregateTable<int, int64_t> t;
+        measure("group-by", "AggregateTable", n, [&] {
+            t.aggregate(keys.data(), values.data(), n, agg::Sum{});
+            footprint = t.memoryBytes();
+            t.finish(agg::Sum{}, checksum);
+        });
+    }
+    {
+        AggregateTable<int, int64_t> t(footprint / 4);
+        measure("group-by", "AggregateTable spill", n, [&] {
+            t.aggregate(keys.data(), values.data(), n, agg::Sum{});
+            t.finish(agg::Sum{}, checksum);
+        });
+    }
+    measure("group-by", "AggregateTable (pool)", n, [&] {
+        aggregateParallel(keys.data(), values.data(), n, agg::Sum{}, pool).finish(agg::Sum{}, checksum);
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {100000, 1000000, 10000000};
+
+    ThreadPool pool;
+    std::printf("threads: %zu\n", pool.threadCount() + 1);
+    printHeader();
+    for (size_t n : sizes) {
+        benchJoin(n, pool);
+        benchGroupBy(n, pool);
+    }
+}
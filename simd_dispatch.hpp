@@ -0,0 +1,276 @@
+#pragma once
+// Runtime-dispatched SIMD kernels for the containers.
+//
+// One binary runs on SSE4.2, AVX2 and AVX-512 hosts: each kernel is
+// compiled once per level with __attribute__((target)), so no -march flag
+// is needed, and the best level the CPU (and OS, for the wider register
+// state) supports is picked once, on first use, from CPUID. Every kernel
+// keeps a portable scalar version, which is all non-x86 builds get.
+//
+// SIMPLE_MAPS_SIMD=scalar|sse4.2|avx2|avx512 caps the level, for testing
+// and for comparing paths; it never raises it above what was detected.
+//
+//   const simd::Kernels& k = simd::kernels();       // resolved once
+//   size_t n = k.countInRange(values, count, lo, hi);
+//   std::printf("simd: %s\n", simd::levelName(simd::activeLevel()));
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SIMD_DISPATCH_X86 1
+#endif
+
+namespace simd {
+
+enum class Level { Scalar, SSE42, AVX2, AVX512 };
+
+inline const char* levelName(Level l) {
+    switch (l) {
+    case Level::Scalar: return "scalar";
+    case Level::SSE42:  return "sse4.2";
+    case Level::AVX2:   return "avx2";
+    case Level::AVX512: return "avx512";
+    }
+    return "?";
+}
+
+// Kernel table; every entry is set for every level.
+struct Kernels {
+    Level level;
+
+    // Number of v[i] with lo <= v[i] < hi. NaNs never match.
+    size_t (*countInRange)(const float* v, size_t n, float lo, float hi);
+
+    // Write the indices i with lo <= v[i] < hi to `out` in increasing
+    // order and return how many. `out` must have room for n entries.
+    size_t (*selectInRange)(const float* v, size_t n, float lo, float hi, uint32_t* out);
+};
+
+// ---------------- scalar ----------------
+
+namespace scalar {
+
+inline size_t countInRange(const float* v, size_t n, float lo, float hi) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += (v[i] >= lo) & (v[i] < hi);
+    return count;
+}
+
+inline size_t selectInRange(const float* v, size_t n, float lo, float hi, uint32_t* out) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[k] = static_cast<uint32_t>(i);          // branch-free: always write, advance on match
+        k += (v[i] >= lo) & (v[i] < hi);
+    }
+    return k;
+}
+
+} // namespace scalar
+
+#ifdef SIMD_DISPATCH_X86
+
+// Compaction tables for select: entry m lists the set lanes of mask m in
+// order, so one shuffle packs the matching indices to the front and the
+// loop stays branch-free. Stores write a full vector; the unused tail is
+// overwritten by the next store or lies within the caller's n entries.
+namespace detail {
+
+struct Compact4 {
+    alignas(16) uint8_t shuffle[16][16];            // pshufb controls over 4 x u32
+    constexpr Compact4() : shuffle{} {
+        for (int m = 0; m < 16; ++m) {
+            int j = 0;
+            for (int b = 0; b < 4; ++b)
+                if (m & (1 << b)) {
+                    for (int byte = 0; byte < 4; ++byte) shuffle[m][4 * j + byte] = static_cast<uint8_t>(4 * b + byte);
+                    ++j;
+                }
+            for (int byte = 4 * j; byte < 16; ++byte) shuffle[m][byte] = 0x80;
+        }
+    }
+};
+
+struct Compact8 {
+    uint64_t lanes[256];                            // byte j: lane of the j-th set bit
+    constexpr Compact8() : lanes{} {
+        for (int m = 0; m < 256; ++m) {
+            uint64_t packed = 0;
+            int j = 0;
+            for (int b = 0; b < 8; ++b)
+                if (m & (1 << b)) packed |= uint64_t(b) << (8 * j++);
+            lanes[m] = packed;
+        }
+    }
+};
+
+inline constexpr Compact4 kCompact4{};
+inline constexpr Compact8 kCompact8{};
+
+} // namespace detail
+
+// ---------------- SSE4.2 ----------------
+
+namespace sse42 {
+
+__attribute__((target("sse4.2"))) inline size_t countInRange(const float* v, size_t n, float lo, float hi) {
+    const __m128 vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(v + i);
+        __m128 in = _mm_and_ps(_mm_cmpge_ps(x, vlo), _mm_cmplt_ps(x, vhi));
+        count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_ps(in))));
+    }
+    return count + scalar::countInRange(v + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse4.2"))) inline size_t selectInRange(const float* v, size_t n, float lo, float hi,
+                                                              uint32_t* out) {
+    const __m128 vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    const __m128i step = _mm_set1_epi32(4);
+    __m128i idx = _mm_setr_epi32(0, 1, 2, 3);
+    size_t k = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(v + i);
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(x, vlo), _mm_cmplt_ps(x, vhi))));
+        __m128i ctl = _mm_load_si128(reinterpret_cast<const __m128i*>(detail::kCompact4.shuffle[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_shuffle_epi8(idx, ctl));
+        k += static_cast<size_t>(__builtin_popcount(mask));
+        idx = _mm_add_epi32(idx, step);
+    }
+    size_t tail = scalar::selectInRange(v + i, n - i, lo, hi, out + k);
+    for (size_t t = 0; t < tail; ++t) out[k + t] += static_cast<uint32_t>(i);
+    return k + tail;
+}
+
+} // namespace sse42
+
+// ---------------- AVX2 ----------------
+
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline size_t countInRange(const float* v, size_t n, float lo, float hi) {
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(v + i);
+        __m256 in = _mm256_and_ps(_mm256_cmp_ps(x, vlo, _CMP_GE_OQ), _mm256_cmp_ps(x, vhi, _CMP_LT_OQ));
+        count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(in))));
+    }
+    return count + scalar::countInRange(v + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) inline size_t selectInRange(const float* v, size_t n, float lo, float hi,
+                                                            uint32_t* out) {
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(v + i);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(
+            _mm256_and_ps(_mm256_cmp_ps(x, vlo, _CMP_GE_OQ), _mm256_cmp_ps(x, vhi, _CMP_LT_OQ))));
+        __m256i perm = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(detail::kCompact8.lanes[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), _mm256_permutevar8x32_epi32(idx, perm));
+        k += static_cast<size_t>(__builtin_popcount(mask));
+        idx = _mm256_add_epi32(idx, step);
+    }
+    size_t tail = scalar::selectInRange(v + i, n - i, lo, hi, out + k);
+    for (size_t t = 0; t < tail; ++t) out[k + t] += static_cast<uint32_t>(i);
+    return k + tail;
+}
+
+} // namespace avx2
+
+// ---------------- AVX-512 ----------------
+
+namespace avx512 {
+
+__attribute__((target("avx512f"))) inline size_t countInRange(const float* v, size_t n, float lo, float hi) {
+    const __m512 vlo = _mm512_set1_ps(lo), vhi = _mm512_set1_ps(hi);
+    size_t count = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(v + i);
+        __mmask16 in = _mm512_mask_cmp_ps_mask(_mm512_cmp_ps_mask(x, vlo, _CMP_GE_OQ), x, vhi, _CMP_LT_OQ);
+        count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(in)));
+    }
+    return count + scalar::countInRange(v + i, n - i, lo, hi);
+}
+
+// Compress-store writes the matching lane indices contiguously.
+__attribute__((target("avx512f"))) inline size_t selectInRange(const float* v, size_t n, float lo, float hi,
+                                                               uint32_t* out) {
+    const __m512 vlo = _mm512_set1_ps(lo), vhi = _mm512_set1_ps(hi);
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t k = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(v + i);
+        __mmask16 in = _mm512_mask_cmp_ps_mask(_mm512_cmp_ps_mask(x, vlo, _CMP_GE_OQ), x, vhi, _CMP_LT_OQ);
+        _mm512_mask_compressstoreu_epi32(out + k, in, idx);
+        k += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(in)));
+        idx = _mm512_add_epi32(idx, step);
+    }
+    size_t tail = scalar::selectInRange(v + i, n - i, lo, hi, out + k);
+    for (size_t t = 0; t < tail; ++t) out[k + t] += static_cast<uint32_t>(i);
+    return k + tail;
+}
+
+} // namespace avx512
+
+#endif // SIMD_DISPATCH_X86
+
+// ---------------- dispatch ----------------
+
+// Best level this CPU and OS support. __builtin_cpu_supports reads CPUID
+// and also checks that the OS saves the YMM / ZMM state (XGETBV).
+inline Level detectedLevel() {
+#ifdef SIMD_DISPATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Level::AVX512;
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return Level::SSE42;
+#endif
+    return Level::Scalar;
+}
+
+// Kernel table for `level`, or for the best supported level below it.
+inline Kernels kernelsFor(Level level) {
+    Level best = detectedLevel();
+    if (level > best) level = best;
+    switch (level) {
+#ifdef SIMD_DISPATCH_X86
+    case Level::AVX512: return {Level::AVX512, avx512::countInRange, avx512::selectInRange};
+    case Level::AVX2:   return {Level::AVX2, avx2::countInRange, avx2::selectInRange};
+    case Level::SSE42:  return {Level::SSE42, sse42::countInRange, sse42::selectInRange};
+#endif
+    default:            return {Level::Scalar, scalar::countInRange, scalar::selectInRange};
+    }
+}
+
+namespace detail {
+
+inline Level requestedLevel() {
+    const char* env = std::getenv("SIMPLE_MAPS_SIMD");
+    if (!env) return Level::AVX512;
+    for (Level l : {Level::Scalar, Level::SSE42, Level::AVX2, Level::AVX512})
+        if (std::strcmp(env, levelName(l)) == 0) return l;
+    return Level::AVX512;
+}
+
+} // namespace detail
+
+// The process-wide table, resolved once (thread-safe static init).
+inline const Kernels& kernels() {
+    static const Kernels table = kernelsFor(detail::requestedLevel());
+    return table;
+}
+
+inline Level activeLevel() { return kernels().level; }
+
+} // namespace simd
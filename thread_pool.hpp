@@ -0,0 +1,104 @@
+#pragma once
+// Fixed-size worker pool shared by the entity system scheduler and the
+// hash-table operators.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool. parallelFor() lets the calling thread work on its
+// own chunks, so it is safe to call from inside a pool task.
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    // Owning pool and index of the current worker thread. A worker of one
+    // pool running work for another is not a worker of the latter.
+    static inline thread_local const ThreadPool* workerPool = nullptr;
+    static inline thread_local size_t workerSlot = SIZE_MAX;
+
+public:
+    explicit ThreadPool(size_t threads = std::max(2u, std::thread::hardware_concurrency()) - 1) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] {
+                workerPool = this;
+                workerSlot = i;
+                for (;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                        if (tasks.empty()) return;
+                        task = std::move(tasks.front());
+                        tasks.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    size_t threadCount() const { return workers.size(); }
+
+    // Worker index on this pool's threads, threadCount() on any other thread
+    // (including workers of other pools).
+    size_t currentSlot() const { return workerPool == this ? workerSlot : workers.size(); }
+
+    void submit(std::function<void()> task) {
+        if (workers.empty()) { task(); return; }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    // fn(begin, end) over [0, n) in chunks of `grain`, returning when all
+    // chunks are done. Helpers that start late find no chunk left and exit
+    // without touching fn.
+    template <class Fn>
+    void parallelFor(size_t n, size_t grain, Fn&& fn) {
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = (n + grain - 1) / grain;
+        if (chunks <= 1 || workers.empty()) {
+            if (n) fn(size_t(0), n);
+            return;
+        }
+
+        struct State { std::atomic<size_t> next{0}, done{0}; };
+        auto state = std::make_shared<State>();
+        auto* body = &fn;
+        auto run = [state, body, chunks, grain, n] {
+            size_t c;
+            while ((c = state->next.fetch_add(1)) < chunks) {
+                (*body)(c * grain, std::min(n, (c + 1) * grain));
+                state->done.fetch_add(1, std::memory_order_release);
+            }
+        };
+        for (size_t h = std::min(workers.size(), chunks - 1); h; --h) submit(run);
+        run();
+        while (state->done.load(std::memory_order_acquire) < chunks) std::this_thread::yield();
+    }
+};
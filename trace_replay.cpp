@@ -0,0 +1,180 @@
+// Replays an operation trace (op_trace.hpp) against the map containers.
+//
+//   g++ -std=c++20 -O2 -pthread trace_replay.cpp -o trace_replay
+//   ./trace_replay trace.bin [--engines=flat,simple,ordered,adaptive,durable,unordered,entity]
+//                            [--repeat=3] [--check]
+//
+// The trace is decoded and its keys materialised before timing, so each
+// run measures only the container calls. Int traces run on every
+// container; string traces on flat_unordered_map, SimpleMap, OrderedMap,
+// AdaptiveMap and DurableMap. Erases
+// are skipped on SimpleMap, which has none. The best of --repeat runs is
+// reported. With --check, find and erase results are compared against the
+// ones recorded (not on SimpleMap, whose contents diverge once an erase is
+// skipped).
+
+#include "map_adapters.hpp"
+#include "bench_util.hpp"
+#include "op_trace.hpp"
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+namespace {
+
+struct Options {
+    const char* path = nullptr;
+    unsigned repeat = 3;
+    bool check = false;
+    std::set<std::string> engines;
+};
+
+struct Counts {
+    uint64_t ops[4] = {};
+    uint64_t findsHit = 0, findsKnown = 0;
+    uint64_t maxInserts = 0;
+};
+
+struct ReplayResult {
+    uint64_t ns = 0;
+    uint64_t executed = 0;
+    uint64_t skipped = 0;
+    uint64_t mismatches = 0;
+    uint64_t checksum = 0;
+};
+
+Counts summarize(const trace::Trace& t) {
+    Counts c;
+    for (auto const& r : t.records) {
+        ++c.ops[static_cast<int>(r.op)];
+        if (r.op == trace::Op::Find && r.result >= 0) {
+            ++c.findsKnown;
+            c.findsHit += static_cast<uint64_t>(r.result);
+        }
+    }
+    c.maxInserts = c.ops[static_cast<int>(trace::Op::Insert)];
+    return c;
+}
+
+template <class Engine, class K>
+ReplayResult replayOnce(const trace::Trace& t, const std::vector<K>& keys, uint64_t expected, bool check) {
+    ReplayResult res;
+    Engine e(static_cast<size_t>(expected));
+    const size_t n = t.records.size();
+
+    uint64_t t0 = bench::nowNs();
+    for (size_t i = 0; i < n; ++i) {
+        const trace::Record& r = t.records[i];
+        switch (r.op) {
+        case trace::Op::Insert:
+            e.insert(keys[i], r.valueSize);
+            break;
+        case trace::Op::Find: {
+            bool hit = e.find(keys[i]);
+            if (check && r.result >= 0 && hit != (r.result == 1)) ++res.mismatches;
+            res.checksum += hit;
+            break;
+        }
+        case trace::Op::Erase:
+            if constexpr (Engine::kErase) {
+                bool erased = e.erase(keys[i]);
+                if (check && r.result >= 0 && erased != (r.result == 1)) ++res.mismatches;
+            } else {
+                ++res.skipped;
+                continue;
+            }
+            break;
+        case trace::Op::Iterate:
+            res.checksum += e.iterate();
+            break;
+        }
+        ++res.executed;
+    }
+    res.ns = bench::nowNs() - t0;
+    bench::doNotOptimize(res.checksum);
+    return res;
+}
+
+template <class Engine, class K>
+void replay(const trace::Trace& t, const std::vector<K>& keys, const Counts& counts, const Options& opt,
+            const char* keyType) {
+    ReplayResult best;
+    for (unsigned i = 0; i < std::max(1u, opt.repeat); ++i) {
+        ReplayResult r = replayOnce<Engine, K>(t, keys, counts.maxInserts, opt.check && Engine::kErase);
+        if (i == 0 || r.ns < best.ns) best = r;
+    }
+    double perOp = best.executed ? static_cast<double>(best.ns) / static_cast<double>(best.executed) : 0.0;
+    std::printf("%-20s %-7s %12llu %10.1f %9.2f %10.3f %9llu ", Engine::kName, keyType,
+                static_cast<unsigned long long>(best.executed), perOp, perOp > 0 ? 1e3 / perOp : 0.0,
+                static_cast<double>(best.ns) / 1e6, static_cast<unsigned long long>(best.skipped));
+    if (opt.check && Engine::kErase) std::printf("%10llu\n", static_cast<unsigned long long>(best.mismatches));
+    else std::printf("%10s\n", "-");
+}
+
+bool selected(const std::set<std::string>& filter, const char* name) {
+    return filter.empty() || filter.count(name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a.rfind("--repeat=", 0) == 0) opt.repeat = static_cast<unsigned>(std::strtoul(argv[i] + 9, nullptr, 10));
+        else if (a.rfind("--engines=", 0) == 0) {
+            std::stringstream ss(a.substr(10));
+            for (std::string item; std::getline(ss, item, ',');) opt.engines.insert(item);
+        } else if (a == "--check") opt.check = true;
+        else if (!opt.path && a.rfind("--", 0) != 0) opt.path = argv[i];
+        else {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!opt.path) {
+        std::fprintf(stderr, "usage: %s trace.bin [--engines=...] [--repeat=N] [--check]\n", argv[0]);
+        return 2;
+    }
+
+    trace::Trace t;
+    std::string error;
+    if (!trace::readTrace(opt.path, t, &error)) {
+        std::fprintf(stderr, "%s: %s\n", opt.path, error.c_str());
+        return 1;
+    }
+
+    Counts c = summarize(t);
+    std::printf("%s: %zu records (insert %llu, find %llu, erase %llu, iterate %llu), %s keys",
+                opt.path, t.records.size(),
+                static_cast<unsigned long long>(c.ops[0]), static_cast<unsigned long long>(c.ops[1]),
+                static_cast<unsigned long long>(c.ops[2]), static_cast<unsigned long long>(c.ops[3]),
+                t.kind == trace::KeyKind::Int ? "int" : "string");
+    if (c.findsKnown)
+        std::printf(", find hit rate %.1f%%", 100.0 * static_cast<double>(c.findsHit) / static_cast<double>(c.findsKnown));
+    std::printf("\n%-20s %-7s %12s %10s %9s %10s %9s %10s\n",
+                "engine", "key", "ops", "ns/op", "Mops/s", "total ms", "skipped", "mismatch");
+
+    using namespace adapters;
+    if (t.kind == trace::KeyKind::Int) {
+        std::vector<int> keys(t.records.size());
+        for (size_t i = 0; i < keys.size(); ++i) keys[i] = static_cast<int>(t.records[i].key);
+        if (selected(opt.engines, "flat")) replay<FlatEngine<int>>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "simple")) replay<SimpleMapEngine<int>>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "ordered")) replay<OrderedMapEngine<int>>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "adaptive")) replay<AdaptiveMapEngine<int>>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "durable")) replay<DurableMapEngine<int>>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "unordered")) replay<UnorderedMapEngine>(t, keys, c, opt, "int");
+        if (selected(opt.engines, "entity")) replay<EntityManagerEngine>(t, keys, c, opt, "int");
+    } else {
+        std::vector<std::string> keys(t.records.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (t.records[i].op != trace::Op::Iterate) keys[i] = std::string(t.stringKey(t.records[i]));
+        if (selected(opt.engines, "flat")) replay<FlatEngine<std::string>>(t, keys, c, opt, "string");
+        if (selected(opt.engines, "simple")) replay<SimpleMapEngine<std::string>>(t, keys, c, opt, "string");
+        if (selected(opt.engines, "ordered")) replay<OrderedMapEngine<std::string>>(t, keys, c, opt, "string");
+        if (selected(opt.engines, "adaptive")) replay<AdaptiveMapEngine<std::string>>(t, keys, c, opt, "string");
+        if (selected(opt.engines, "durable")) replay<DurableMapEngine<std::string>>(t, keys, c, opt, "string");
+    }
+}
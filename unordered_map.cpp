@@ -1,3 +1,6 @@
+#ifndef SIMPLE_MAPS_UNORDERED_MAP_CPP
+#define SIMPLE_MAPS_UNORDERED_MAP_CPP
+
 #include <iostream>
 #include <vector>
 #include <list>
@@ -5,6 +8,8 @@
 #include <functional>
 #include <string>
 
+#include "hashing.hpp"
+
 class UnorderedMap {
 public:
     using Key   = int;
@@ -18,7 +23,7 @@ private:
     size_t numElements = 0;
 
     size_t getBucketIndex(const Key& key) const {
-        return std::hash<Key>{}(key) % buckets.size();
+        return hashing::Hash<Key>{}(key) % buckets.size();
     }
 
 public:
@@ -77,8 +82,21 @@ public:
     size_t size() const {
         return numElements;
     }
+
+    // Visit every pair: fn(const Key&, Value&)
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& bucket : buckets) {
+            for (auto& kv : bucket) {
+                fn(static_cast<const Key&>(kv.first), kv.second);
+            }
+        }
+    }
 };
 
+#endif // SIMPLE_MAPS_UNORDERED_MAP_CPP
+
+#ifndef SIMPLE_MAPS_NO_MAIN
 int main() {
     UnorderedMap map;
 
@@ -99,3 +117,4 @@ int main() {
 
     return 0;
 }
+#endif
@@ -2,27 +2,907 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <span>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ENTITY_HAVE_MMAP 1
+#endif
+
+#include "hashing.hpp"
+#include "simd_dispatch.hpp"
+#include "thread_pool.hpp"
+#include "varint.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ENTITY_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define ENTITY_PREFETCH(addr) ((void)(addr))
+#endif
+
+using NameId = uint32_t;
+
+// Interned entity names: each distinct name is stored once and entities
+// carry a 4-byte NameId instead of a std::string.
+class NamePool {
+    std::unordered_map<std::string, NameId, hashing::StringHash, std::equal_to<>> ids;
+    std::vector<const std::string*> names;         // NameId -> key in `ids` (nodes are stable)
+
+public:
+    static constexpr NameId kNone = UINT32_MAX;
+
+    NameId intern(std::string_view s) {
+        auto it = ids.find(s);
+        if (it != ids.end()) return it->second;
+        NameId id = static_cast<NameId>(names.size());
+        auto [pos, inserted] = ids.emplace(std::string(s), id);
+        (void)inserted;
+        names.push_back(&pos->first);
+        return id;
+    }
+
+    NameId find(std::string_view s) const {
+        auto it = ids.find(s);
+        return it == ids.end() ? kNone : it->second;
+    }
+
+    const std::string& name(NameId id) const { return *names[id]; }
+    size_t size() const { return names.size(); }
+};
 
 struct Entity {
     int id;
-    std::string name;
+    NameId name;
     float health;
 };
 
-class EntityManager {
-    std::vector<Entity> entities;                  // contiguous storage
+// ---------------- Snapshot file format ----------------
+//
+//   SnapshotHeader
+//   int32_t  ids[count]
+//   float    health[count]
+//   uint32_t nameIds[count]             // into the symbol table
+//   uint32_t nameOffsets[symbols + 1]   // into the name blob
+//   char     nameBlob[blobBytes]
+//   Entry    sortedIndex[count]         // (id, index) sorted by id
+//
+// Every section starts on an 8-byte boundary so a mapped file can be read
+// in place without copying.
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t symbols;
+    uint64_t count;
+    uint64_t blobBytes;
+};
+
+struct SnapshotIndexEntry {
+    int32_t  id;
+    uint32_t index;
+};
+
+static constexpr char     kSnapshotMagic[8] = {'E', 'N', 'T', 'S', 'N', 'A', 'P', '1'};
+static constexpr uint32_t kSnapshotVersion  = 2;
+
+inline uint64_t alignSnapshot(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+// Read-only view of a whole file: mmap where available, otherwise read into memory.
+class MappedFile {
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> fallback_;
+#ifdef ENTITY_HAVE_MMAP
+    bool mapped_ = false;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef ENTITY_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        data_ = static_cast<const char*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+        mapped_ = true;
+        return true;
+#else
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        std::fseek(f, 0, SEEK_END);
+        long len = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        if (len <= 0) { std::fclose(f); return false; }
+        fallback_.resize(static_cast<size_t>(len));
+        bool ok = std::fread(fallback_.data(), 1, fallback_.size(), f) == fallback_.size();
+        std::fclose(f);
+        if (!ok) { fallback_.clear(); return false; }
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef ENTITY_HAVE_MMAP
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+        mapped_ = false;
+#endif
+        fallback_.clear();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+// Zero-copy view over a snapshot file. Columns are read straight out of the
+// mapping, and indexOfId() binary-searches the stored index in place. open()
+// is not O(1): it validates the name offsets, name ids and the whole id
+// index in one O(n) pass, so that a truncated or malformed file is rejected
+// instead of read out of bounds. That pass reads every page of those
+// sections (about 30 ms for 10M entities from a warm page cache).
+class EntitySnapshotView {
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    const int32_t* ids = nullptr;
+    const float* healths = nullptr;
+    const uint32_t* nameIds = nullptr;
+    const uint32_t* nameOffsets = nullptr;
+    const char* nameBlob = nullptr;
+    const SnapshotIndexEntry* sortedIndex = nullptr;
+
+public:
+    bool open(const std::string& path) {
+        header = nullptr;
+        if (!file.open(path)) return false;
+        if (file.size() < sizeof(SnapshotHeader)) return false;
+
+        auto* h = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (std::memcmp(h->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+        if (h->version != kSnapshotVersion) return false;
+
+        // Every counted item takes at least 4 bytes of the file, so bounding
+        // the counts by the file size keeps the offset arithmetic below from
+        // overflowing.
+        const uint64_t size = file.size();
+        uint64_t n = h->count;
+        if (n > size / 4 || h->symbols >= size / 4 || h->blobBytes > size) return false;
+        uint64_t off = alignSnapshot(sizeof(SnapshotHeader));
+        uint64_t idsOff = off;     off = alignSnapshot(off + n * sizeof(int32_t));
+        uint64_t healthOff = off;  off = alignSnapshot(off + n * sizeof(float));
+        uint64_t nameIdsOff = off; off = alignSnapshot(off + n * sizeof(uint32_t));
+        uint64_t offsetsOff = off; off = alignSnapshot(off + (uint64_t(h->symbols) + 1) * sizeof(uint32_t));
+        uint64_t blobOff = off;    off = alignSnapshot(off + h->blobBytes);
+        uint64_t indexOff = off;   off = off + n * sizeof(SnapshotIndexEntry);
+        if (off > size) return false;
+
+        ids = reinterpret_cast<const int32_t*>(file.data() + idsOff);
+        healths = reinterpret_cast<const float*>(file.data() + healthOff);
+        nameIds = reinterpret_cast<const uint32_t*>(file.data() + nameIdsOff);
+        nameOffsets = reinterpret_cast<const uint32_t*>(file.data() + offsetsOff);
+        nameBlob = file.data() + blobOff;
+        sortedIndex = reinterpret_cast<const SnapshotIndexEntry*>(file.data() + indexOff);
+
+        // Names: offsets start at 0, never decrease and end at the blob size.
+        if (nameOffsets[0] != 0 || nameOffsets[h->symbols] != h->blobBytes) return false;
+        for (uint32_t s = 0; s < h->symbols; ++s)
+            if (nameOffsets[s] > nameOffsets[s + 1]) return false;
+        for (uint64_t i = 0; i < n; ++i)
+            if (nameIds[i] >= h->symbols) return false;
+        // Index: strictly increasing ids, each pointing at the entity with
+        // that id. That also rules out duplicate ids among the entities.
+        for (uint64_t i = 0; i < n; ++i) {
+            const SnapshotIndexEntry& e = sortedIndex[i];
+            if (e.index >= n || ids[e.index] != e.id) return false;
+            if (i && sortedIndex[i - 1].id >= e.id) return false;
+        }
+        header = h;
+        return true;
+    }
+
+    bool valid() const { return header != nullptr; }
+    size_t size() const { return header ? static_cast<size_t>(header->count) : 0; }
+
+    int id(size_t i) const { return ids[i]; }
+    float health(size_t i) const { return healths[i]; }
+    uint32_t nameId(size_t i) const { return nameIds[i]; }
+    std::string_view name(size_t i) const { return symbol(nameIds[i]); }
+
+    size_t symbolCount() const { return header ? header->symbols : 0; }
+    std::string_view symbol(uint32_t s) const {
+        return {nameBlob + nameOffsets[s], nameOffsets[s + 1] - nameOffsets[s]};
+    }
+
+    // Binary search in the stored id index; returns size() if absent.
+    size_t indexOfId(int id) const {
+        const SnapshotIndexEntry* end = sortedIndex + size();
+        auto it = std::lower_bound(sortedIndex, end, id,
+            [](const SnapshotIndexEntry& e, int key) { return e.id < key; });
+        return (it != end && it->id == id) ? it->index : size();
+    }
+
+    const int32_t* idColumn() const { return ids; }
+    const float* healthColumn() const { return healths; }
+
+    // Entities with lo <= health < hi, counted over the column with SIMD.
+    size_t countHealthInRange(float lo, float hi) const {
+        return simd::kernels().countInRange(healths, size(), lo, hi);
+    }
+};
+
+// ---------------- Change tracking ----------------
+
+// Per-entity field bits, used for change journal records and delta encoding.
+namespace EntityField {
+    constexpr uint8_t Name    = 1 << 0;
+    constexpr uint8_t Health  = 1 << 1;
+    constexpr uint8_t All     = Name | Health;
+    constexpr uint8_t Added   = 1 << 6;   // journal only
+    constexpr uint8_t Removed = 1 << 7;   // journal only
+}
+
+struct ChangeRecord {
+    uint64_t version;
+    int      id;
+    uint8_t  fields;
+};
+
+inline uint64_t zigzag(int v) { return zigzag64(v); }
+inline int unzigzag(uint64_t v) { return static_cast<int>(unzigzag64(v)); }
+
+// ---------------- Chunked dense storage ----------------
+
+// Vector-like storage made of fixed-size, cache-line-aligned blocks. Growth
+// allocates a new block and never moves existing elements, so push_back has
+// no reallocation stall and pointers stay valid until the element itself is
+// moved or removed.
+template <class T, size_t ChunkBytes = 16 * 1024>
+class ChunkedVector {
+public:
+    static constexpr size_t kPerChunk =
+        std::bit_floor(ChunkBytes / sizeof(T) ? ChunkBytes / sizeof(T) : size_t(1));
+    static constexpr size_t kShift = std::countr_zero(kPerChunk);
+    static constexpr size_t kMask = kPerChunk - 1;
+    static constexpr std::align_val_t kAlign{64};
+
+private:
+    std::vector<T*> chunks;
+    size_t count = 0;
+
+    T* slot(size_t i) const { return chunks[i >> kShift] + (i & kMask); }
+
+public:
+    ChunkedVector() = default;
+    ChunkedVector(const ChunkedVector&) = delete;
+    ChunkedVector& operator=(const ChunkedVector&) = delete;
+    ChunkedVector(ChunkedVector&& o) noexcept
+        : chunks(std::move(o.chunks)), count(std::exchange(o.count, 0)) {}
+    ChunkedVector& operator=(ChunkedVector&& o) noexcept {
+        if (this != &o) {
+            clear();
+            release();
+            chunks = std::move(o.chunks);
+            count = std::exchange(o.count, 0);
+        }
+        return *this;
+    }
+    ~ChunkedVector() {
+        clear();
+        release();
+    }
+
+    T& operator[](size_t i) { return *slot(i); }
+    const T& operator[](size_t i) const { return *slot(i); }
+    T& back() { return *slot(count - 1); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return chunks.size() * kPerChunk; }
+
+    void reserve(size_t n) {
+        while (capacity() < n)
+            chunks.push_back(static_cast<T*>(::operator new(sizeof(T) * kPerChunk, kAlign)));
+    }
+
+    void push_back(const T& v) {
+        if (count == capacity()) reserve(count + 1);
+        new (slot(count)) T(v);
+        ++count;
+    }
+    void push_back(T&& v) {
+        if (count == capacity()) reserve(count + 1);
+        new (slot(count)) T(std::move(v));
+        ++count;
+    }
+
+    void pop_back() { slot(--count)->~T(); }
+
+    // Destroys elements but keeps the blocks for reuse.
+    void clear() {
+        while (count) pop_back();
+    }
+
+    void release() {
+        for (T* c : chunks) ::operator delete(c, kAlign);
+        chunks.clear();
+    }
+
+    // Block-linear traversal: fn(std::span<T>) once per non-empty block.
+    template <class Fn>
+    void forEachChunk(Fn&& fn) {
+        for (size_t c = 0; c * kPerChunk < count; ++c)
+            fn(std::span<T>(chunks[c], std::min(kPerChunk, count - c * kPerChunk)));
+    }
+
+    template <class Ref, class Owner>
+    class Iter {
+        Owner* v;
+        size_t i;
+    public:
+        Iter(Owner* v, size_t i) : v(v), i(i) {}
+        Ref operator*() const { return (*v)[i]; }
+        Iter& operator++() { ++i; return *this; }
+        bool operator!=(const Iter& o) const { return i != o.i; }
+    };
+
+    auto begin() { return Iter<T&, ChunkedVector>(this, 0); }
+    auto end() { return Iter<T&, ChunkedVector>(this, count); }
+    auto begin() const { return Iter<const T&, const ChunkedVector>(this, 0); }
+    auto end() const { return Iter<const T&, const ChunkedVector>(this, count); }
+};
+
+// ---------------- Frame arena ----------------
+
+// Monotonic bump allocator for per-tick temporaries. reset() rewinds to the
+// first block in O(1) and keeps every block, so a warmed-up arena does not
+// touch the global allocator. Not thread-safe; see TickArena.
+class FrameArena {
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;                 // block being bumped
+    size_t offset = 0;                  // bytes used in blocks[current]
+    size_t blockSize;
+
+public:
+    explicit FrameArena(size_t blockBytes = 64 * 1024) : blockSize(blockBytes) {}
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        for (; current < blocks.size(); ++current, offset = 0) {
+            Block& b = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+            size_t start = ((base + offset + align - 1) & ~uintptr_t(align - 1)) - base;
+            if (start + bytes <= b.size) {
+                offset = start + bytes;
+                return b.data.get() + start;
+            }
+        }
+        size_t size = std::max(blockSize, bytes + align);
+        blocks.push_back({std::make_unique<std::byte[]>(size), size});
+        current = blocks.size() - 1;
+        offset = 0;
+        return allocate(bytes, align);
+    }
+
+    // Uninitialised storage for n trivially destructible Ts.
+    template <class T>
+    std::span<T> allocateArray(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destroyed");
+        return {static_cast<T*>(allocate(n * sizeof(T), alignof(T))), n};
+    }
+
+    void reset() {
+        current = 0;
+        offset = 0;
+    }
+
+    size_t bytesReserved() const {
+        size_t total = 0;
+        for (auto const& b : blocks) total += b.size;
+        return total;
+    }
+};
+
+// std allocator adapter, for containers that live within one tick.
+template <class T>
+struct ArenaAllocator {
+    using value_type = T;
+    FrameArena* arena;
+
+    explicit ArenaAllocator(FrameArena& a) : arena(&a) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// One arena per thread for parallel systems, all reset together at tick end.
+class TickArena {
+    struct Local {
+        std::thread::id owner;
+        std::unique_ptr<FrameArena> arena;
+    };
+
+    std::mutex mutex;
+    std::vector<Local> locals;
+    const uint64_t serial;
+
+    static uint64_t nextSerial() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+public:
+    TickArena() : serial(nextSerial()) {}
+
+    // The calling thread's arena. Cached per thread, so the lock is only
+    // taken the first time a thread asks (or after switching TickArenas).
+    FrameArena& local() {
+        thread_local uint64_t cachedSerial = 0;
+        thread_local FrameArena* cached = nullptr;
+        if (cachedSerial == serial) return *cached;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto self = std::this_thread::get_id();
+        auto it = std::find_if(locals.begin(), locals.end(),
+            [&](const Local& l) { return l.owner == self; });
+        if (it == locals.end()) {
+            locals.push_back({self, std::make_unique<FrameArena>()});
+            it = locals.end() - 1;
+        }
+        cachedSerial = serial;
+        cached = it->arena.get();
+        return *cached;
+    }
+
+    // Call between ticks, when no thread is allocating.
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& l : locals) l.arena->reset();
+    }
+};
+
+// ---------------- Published frames ----------------
+
+// Immutable column copy of the entities, published by the simulation thread
+// for render/network readers.
+struct EntityFrame {
+    uint64_t version = 0;
+    std::vector<int> ids;
+    std::vector<NameId> names;
+    std::vector<float> health;
+    std::shared_ptr<const std::vector<std::string>> nameTable;   // shared until the pool grows
+
+    mutable std::atomic<uint32_t> readers{0};
+};
+
+// Read handle on a published frame. Holding it keeps the frame from being
+// recycled by the writer; it never blocks the writer.
+class EntityFrameView {
+    const EntityFrame* frame = nullptr;
+
+public:
+    EntityFrameView() = default;
+    explicit EntityFrameView(const EntityFrame* f) : frame(f) {}
+    EntityFrameView(EntityFrameView&& o) noexcept : frame(std::exchange(o.frame, nullptr)) {}
+    EntityFrameView& operator=(EntityFrameView&& o) noexcept {
+        if (this != &o) {
+            release();
+            frame = std::exchange(o.frame, nullptr);
+        }
+        return *this;
+    }
+    EntityFrameView(const EntityFrameView&) = delete;
+    EntityFrameView& operator=(const EntityFrameView&) = delete;
+    ~EntityFrameView() { release(); }
+
+    void release() {
+        if (frame) frame->readers.fetch_sub(1, std::memory_order_release);
+        frame = nullptr;
+    }
+
+    explicit operator bool() const { return frame != nullptr; }
+    uint64_t version() const { return frame ? frame->version : 0; }
+    size_t size() const { return frame ? frame->ids.size() : 0; }
+
+    int id(size_t i) const { return frame->ids[i]; }
+    float health(size_t i) const { return frame->health[i]; }
+    const std::string& name(size_t i) const { return (*frame->nameTable)[frame->names[i]]; }
+
+    std::span<const int> ids() const { return frame->ids; }
+    std::span<const float> healthColumn() const { return frame->health; }
+
+    // Entities with lo <= health < hi, counted over the column with SIMD.
+    size_t countHealthInRange(float lo, float hi) const {
+        return frame ? simd::kernels().countInRange(frame->health.data(), frame->health.size(), lo, hi) : 0;
+    }
+};
+
+// Single writer, many readers. The writer fills a frame nobody is reading
+// and publishes it with one atomic pointer store; readers pin the current
+// frame with a reference count. Frames are recycled, never freed while the
+// exchange lives, because a slow reader may still be about to pin one.
+class FrameExchange {
+    std::vector<std::unique_ptr<EntityFrame>> frames;     // writer-owned
+    std::atomic<EntityFrame*> published{nullptr};
+
+public:
+    // Writer: a frame that is neither published nor pinned. Starts with
+    // three buffers and only grows while readers hold on to old frames.
+    EntityFrame* writable() {
+        EntityFrame* current = published.load();
+        for (auto& f : frames)
+            if (f.get() != current && f->readers.load() == 0) return f.get();
+        size_t grow = frames.empty() ? 3 : 1;
+        for (size_t i = 0; i < grow; ++i) frames.push_back(std::make_unique<EntityFrame>());
+        return frames[frames.size() - grow].get();
+    }
+
+    void publish(EntityFrame* f) { published.store(f); }
+
+    // Reader: lock-free; retries only if a publish raced with the pin.
+    EntityFrameView acquire() const {
+        for (;;) {
+            EntityFrame* f = published.load();
+            if (!f) return {};
+            f->readers.fetch_add(1);
+            if (published.load() == f) return EntityFrameView(f);
+            f->readers.fetch_sub(1);
+        }
+    }
+
+    size_t frameCount() const { return frames.size(); }
+};
+
+// Storage is std::vector<Entity> (EntityManager) or ChunkedVector<Entity>
+// (ChunkedEntityManager); both keep entities dense and index-addressable.
+template <class Storage>
+class BasicEntityManager {
+    // Per-slot bookkeeping kept parallel to `entities` and moved with it.
+    struct SlotMeta {
+        uint64_t journalPos;    // absolute position of this entity's newest journal record
+        uint32_t namePos;       // position of the id in byName[entity.name]
+        uint32_t rangeBucket;   // health index bucket, if the index is enabled
+        uint32_t rangePos;      // position within that bucket
+    };
+
+    // Histogram index over health: equal-width buckets over [lo, hi), values
+    // outside the range clamp to the edge buckets. Each bucket keeps ids and
+    // values side by side so boundary buckets filter without touching entities.
+    struct RangeBucket {
+        std::vector<int> ids;
+        std::vector<float> values;
+    };
+
+    // A running reorder pass: keys are captured, merge-sorted and then
+    // applied, each phase a bounded amount of work per reorderStep().
+    struct ReorderPass {
+        enum Phase : uint8_t { Keying, Sorting, Placing };
+        Phase phase = Keying;
+        std::function<uint64_t(const Entity&)> key;
+        std::vector<std::pair<uint64_t, int>> plan;     // (key, id), target order once sorted
+        std::vector<std::pair<uint64_t, int>> scratch;  // merge output while sorting
+        size_t pos = 0;                                 // Keying: next slot; Placing: next plan entry
+        size_t width = 1;                               // Sorting: length of the runs being merged
+        size_t lo = 0, left = 0, right = 0, out = 0;    // Sorting: the merge in progress
+        size_t placePos = 0;                            // Placing: next slot to fill
+    };
+
+    static constexpr uint64_t kNoRecord = UINT64_MAX;
+
+    Storage entities;                              // dense storage
+    std::vector<SlotMeta> meta;                    // parallel to entities
     std::unordered_map<int, size_t> indexOf;       // maps entity ID -> index in vector
+    NamePool names;
+    std::vector<std::vector<int>> byName;          // NameId -> ids of entities with that name
+
+    std::unique_ptr<FrameExchange> frames = std::make_unique<FrameExchange>();
+    std::shared_ptr<const std::vector<std::string>> publishedNames;
+
+    bool stableOrder = false;                      // remove by shifting instead of swap-and-pop
+    std::unique_ptr<ReorderPass> reorder;          // null when no pass is running
+
+    std::vector<RangeBucket> healthBuckets;        // empty when the index is off
+    float healthLo = 0.f, healthScale = 0.f;       // bucket = (h - lo) * scale
+    bool healthBatched = false;                    // rebuild on query instead of per mutation
+    bool healthDirty = false;
+    std::vector<uint32_t> rangeScratch;            // boundary-bucket match positions
+
+    // Persistent filter with its current matches as dense slot indices.
+    struct CachedQuery {
+        std::function<bool(const Entity&)> pred;    // empty once unregistered
+        uint8_t fields;                             // columns the predicate reads
+        std::vector<uint32_t> members;              // matching slots
+        std::vector<uint32_t> posOf;                // slot -> position in members
+    };
+
+    static constexpr uint32_t kNotMember = UINT32_MAX;
+    std::vector<CachedQuery> queries;
+
+    std::vector<ChangeRecord> journal;             // ordered by version
+    uint64_t journalBase = 0;                      // absolute position of journal[0]
+    uint64_t version = 1;                          // version new changes are tagged with
+    uint64_t trimmedThrough = 0;                   // records up to this version are gone
+    size_t journalLimit = size_t(1) << 20;         // records kept before dropping them all
+
+    // Drop every record and close the current version: clients behind it
+    // get 0 from encodeDelta() and resync from a snapshot.
+    void dropJournal() {
+        journalBase += journal.size();
+        journal.clear();
+        trimmedThrough = version++;
+    }
+
+    // Record a change for the entity in `index`. Changes within one version
+    // are coalesced into a single record. Without a client trimming it, the
+    // journal would grow with every add and remove; past journalLimit it is
+    // dropped instead.
+    void recordChange(size_t index, uint8_t fields) {
+        SlotMeta& m = meta[index];
+        if (m.journalPos != kNoRecord && m.journalPos >= journalBase) {
+            ChangeRecord& r = journal[m.journalPos - journalBase];
+            if (r.version == version) {
+                r.fields |= fields;
+                return;
+            }
+        }
+        if (journal.size() >= journalLimit) dropJournal();
+        m.journalPos = journalBase + journal.size();
+        journal.push_back({version, entities[index].id, fields});
+    }
+
+    void linkName(size_t index) {
+        const Entity& e = entities[index];
+        if (byName.size() <= e.name) byName.resize(e.name + 1);
+        meta[index].namePos = static_cast<uint32_t>(byName[e.name].size());
+        byName[e.name].push_back(e.id);
+    }
+
+    // Swap-and-pop the entity out of its name's id list.
+    void unlinkName(size_t index) {
+        std::vector<int>& ids = byName[entities[index].name];
+        uint32_t pos = meta[index].namePos;
+        if (pos + 1 != ids.size()) {
+            ids[pos] = ids.back();
+            meta[indexOf[ids[pos]]].namePos = pos;
+        }
+        ids.pop_back();
+    }
+
+    uint32_t healthBucketOf(float h) const {
+        float b = (h - healthLo) * healthScale;
+        if (!(b >= 0.f)) return 0;                      // also catches NaN
+        uint32_t last = static_cast<uint32_t>(healthBuckets.size() - 1);
+        return b >= static_cast<float>(last) ? last : static_cast<uint32_t>(b);
+    }
+
+    void indexHealth(size_t index) {
+        const Entity& e = entities[index];
+        uint32_t b = healthBucketOf(e.health);
+        RangeBucket& bucket = healthBuckets[b];
+        meta[index].rangeBucket = b;
+        meta[index].rangePos = static_cast<uint32_t>(bucket.ids.size());
+        bucket.ids.push_back(e.id);
+        bucket.values.push_back(e.health);
+    }
+
+    void unindexHealth(size_t index) {
+        RangeBucket& bucket = healthBuckets[meta[index].rangeBucket];
+        uint32_t pos = meta[index].rangePos;
+        if (pos + 1 != bucket.ids.size()) {
+            bucket.ids[pos] = bucket.ids.back();
+            bucket.values[pos] = bucket.values.back();
+            meta[indexOf[bucket.ids[pos]]].rangePos = pos;
+        }
+        bucket.ids.pop_back();
+        bucket.values.pop_back();
+    }
+
+    // Keep the health index in step with entities[index].health.
+    void healthChanged(size_t index) {
+        if (healthBuckets.empty()) return;
+        if (healthBatched) { healthDirty = true; return; }
+        float h = entities[index].health;
+        if (healthBucketOf(h) == meta[index].rangeBucket) {
+            healthBuckets[meta[index].rangeBucket].values[meta[index].rangePos] = h;
+        } else {
+            unindexHealth(index);
+            indexHealth(index);
+        }
+    }
+
+    // Caller has already mapped e.id to entities.size() in indexOf.
+    static void addMember(CachedQuery& q, size_t index) {
+        q.posOf[index] = static_cast<uint32_t>(q.members.size());
+        q.members.push_back(static_cast<uint32_t>(index));
+    }
+
+    static void removeMember(CachedQuery& q, size_t index) {
+        uint32_t pos = q.posOf[index];
+        if (pos + 1 != q.members.size()) {
+            q.members[pos] = q.members.back();
+            q.posOf[q.members[pos]] = pos;
+        }
+        q.members.pop_back();
+        q.posOf[index] = kNotMember;
+    }
+
+    // Re-run every live query that reads one of `fields` on slot `index`.
+    void requery(size_t index, uint8_t fields) {
+        for (auto& q : queries) {
+            if (!q.pred || !(q.fields & fields)) continue;
+            bool match = q.pred(entities[index]);
+            bool member = q.posOf[index] != kNotMember;
+            if (match && !member) addMember(q, index);
+            else if (!match && member) removeMember(q, index);
+        }
+    }
+
+    void appendSlot(const Entity& e) {
+        size_t index = entities.size();
+        entities.push_back(e);
+        meta.push_back({kNoRecord, 0, 0, 0});
+        linkName(index);
+        if (!healthBuckets.empty()) {
+            if (healthBatched) healthDirty = true;
+            else indexHealth(index);
+        }
+        for (auto& q : queries) {
+            q.posOf.push_back(kNotMember);
+            if (q.pred && q.pred(entities[index])) addMember(q, index);
+        }
+    }
+
+    // `to` must already be out of every query (vacated by a removal or move).
+    void moveSlot(size_t from, size_t to) {
+        entities[to] = entities[from];
+        meta[to] = meta[from];
+        indexOf[entities[to].id] = to;
+        for (auto& q : queries) {
+            uint32_t pos = q.posOf[from];
+            q.posOf[to] = pos;
+            q.posOf[from] = kNotMember;
+            if (pos != kNotMember) q.members[pos] = static_cast<uint32_t>(to);
+        }
+    }
+
+    void popSlot() {
+        entities.pop_back();
+        meta.pop_back();
+        for (auto& q : queries) q.posOf.pop_back();
+    }
+
+    void swapSlots(size_t a, size_t b) {
+        std::swap(entities[a], entities[b]);
+        std::swap(meta[a], meta[b]);
+        indexOf[entities[a].id] = a;
+        indexOf[entities[b].id] = b;
+        for (auto& q : queries) {
+            std::swap(q.posOf[a], q.posOf[b]);
+            if (q.posOf[a] != kNotMember) q.members[q.posOf[a]] = static_cast<uint32_t>(a);
+            if (q.posOf[b] != kNotMember) q.members[q.posOf[b]] = static_cast<uint32_t>(b);
+        }
+    }
+
+    // Single funnel for field changes: journal, health index, cached queries.
+    void fieldsChanged(size_t index, uint8_t fields) {
+        recordChange(index, fields);
+        if (fields & EntityField::Health) healthChanged(index);
+        requery(index, fields);
+    }
+
+    void setHealthAt(size_t index, float health) {
+        entities[index].health = health;
+        fieldsChanged(index, EntityField::Health);
+    }
+
+    void setNameAt(size_t index, NameId sym) {
+        if (entities[index].name == sym) return;
+        unlinkName(index);
+        entities[index].name = sym;
+        linkName(index);
+        fieldsChanged(index, EntityField::Name);
+    }
 
 public:
+    enum class AddStatus : uint8_t { Added, Exists, Updated };
+
+    struct AddResult {
+        AddStatus status;
+        Entity* entity;         // the new, existing or updated entity
+    };
+
+    struct Spawn {
+        int id;
+        std::string_view name;
+        float health;
+    };
+
     // Insert new entity
-    void addEntity(int id, std::string name, float health) {
-        if (indexOf.find(id) != indexOf.end()) {
+    void addEntity(int id, std::string_view name, float health) {
+        if (tryAddEntity(id, name, health).status == AddStatus::Exists)
             std::cout << "Entity " << id << " already exists!\n";
-            return;
+    }
+
+    // Insert unless the id exists; never does I/O. One hash probe either way.
+    AddResult tryAddEntity(int id, std::string_view name, float health) {
+        auto [it, inserted] = indexOf.try_emplace(id, entities.size());
+        if (!inserted) return {AddStatus::Exists, &entities[it->second]};
+        appendSlot({id, names.intern(name), health});
+        recordChange(it->second, EntityField::Added | EntityField::All);
+        return {AddStatus::Added, &entities[it->second]};
+    }
+
+    // Insert, or overwrite name and health of an existing entity.
+    AddResult upsertEntity(int id, std::string_view name, float health) {
+        auto [it, inserted] = indexOf.try_emplace(id, entities.size());
+        size_t index = it->second;
+        if (inserted) {
+            appendSlot({id, names.intern(name), health});
+            recordChange(index, EntityField::Added | EntityField::All);
+            return {AddStatus::Added, &entities[index]};
         }
-        size_t index = entities.size();
-        entities.push_back({id, std::move(name), health});
-        indexOf[id] = index;
+        setNameAt(index, names.intern(name));
+        if (entities[index].health != health) setHealthAt(index, health);
+        return {AddStatus::Updated, &entities[index]};
+    }
+
+    // Bulk insert: makes room for the whole batch up front, then
+    // tryAddEntity per spawn. results[i] receives the status of spawns[i];
+    // returns the number added. Storage grows at least geometrically, so
+    // spawning in many small waves stays linear overall.
+    size_t addEntities(std::span<const Spawn> spawns, std::span<AddStatus> results) {
+        size_t need = entities.size() + spawns.size();
+        if (entities.capacity() < need) entities.reserve(std::max(need, 2 * entities.capacity()));
+        if (meta.capacity() < need) meta.reserve(std::max(need, 2 * meta.capacity()));
+        size_t added = 0;
+        for (size_t i = 0; i < spawns.size(); ++i) {
+            results[i] = tryAddEntity(spawns[i].id, spawns[i].name, spawns[i].health).status;
+            added += results[i] == AddStatus::Added;
+        }
+        return added;
     }
 
     // Find entity by ID
@@ -32,6 +912,66 @@ public:
         return &entities[it->second];
     }
 
+    // ---------------- Batched lookup ----------------
+
+    static constexpr size_t kLookupBatch = 16;
+
+    // Resolve many ids at once: out[i] = getEntity(ids[i]). Lookups run in
+    // groups whose hash probes are independent, so their misses overlap, and
+    // every dense slot is prefetched before it is handed out. Returns the
+    // number of ids found; `out` must be at least as long as `ids`.
+    size_t getEntities(std::span<const int> ids, std::span<Entity*> out) {
+        size_t found = 0;
+        forEachBatch(ids, [&](size_t i, size_t index) {
+            out[i] = index == SIZE_MAX ? nullptr : &entities[index];
+            found += index != SIZE_MAX;
+        });
+        return found;
+    }
+
+    // As above, with the result array taken from a frame arena.
+    std::span<Entity*> getEntities(std::span<const int> ids, FrameArena& arena) {
+        std::span<Entity*> out = arena.allocateArray<Entity*>(ids.size());
+        getEntities(ids, out);
+        return out;
+    }
+
+    // Gather-style variant: copy the health of each id into `out`, writing
+    // `missing` for ids that do not exist.
+    void gatherHealth(std::span<const int> ids, std::span<float> out, float missing = 0.f) {
+        forEachBatch(ids, [&](size_t i, size_t index) {
+            out[i] = index == SIZE_MAX ? missing : entities[index].health;
+        });
+    }
+
+private:
+    template <class Fn>
+    void forEachBatch(std::span<const int> ids, Fn&& fn) {
+        size_t slots[kLookupBatch];
+        for (size_t base = 0; base < ids.size(); base += kLookupBatch) {
+            size_t n = std::min(kLookupBatch, ids.size() - base);
+            // Load pass, not a prefetch: std::unordered_map exposes neither
+            // its bucket array nor node addresses, so this walks to each id's
+            // bucket with ordinary loads. They are independent and issued
+            // back to back, so their misses overlap instead of each waiting on
+            // the previous find; only the first node, whose address those
+            // loads yield, is prefetched. The finds below then mostly hit
+            // cache.
+            for (size_t j = 0; j < n; ++j) {
+                size_t bucket = indexOf.bucket(ids[base + j]);
+                auto node = indexOf.begin(bucket);
+                if (node != indexOf.end(bucket)) ENTITY_PREFETCH(&*node);
+            }
+            for (size_t j = 0; j < n; ++j) {
+                auto it = indexOf.find(ids[base + j]);
+                slots[j] = it == indexOf.end() ? SIZE_MAX : it->second;
+                if (slots[j] != SIZE_MAX) ENTITY_PREFETCH(&entities[slots[j]]);
+            }
+            for (size_t j = 0; j < n; ++j) fn(base + j, slots[j]);
+        }
+    }
+
+public:
     // Remove entity (swap-and-pop to keep vector packed)
     void removeEntity(int id) {
         auto it = indexOf.find(id);
@@ -39,26 +979,712 @@ public:
 
         size_t index = it->second;
         size_t lastIndex = entities.size() - 1;
+        recordChange(index, EntityField::Removed);
+        unlinkName(index);
+        if (!healthBuckets.empty()) {
+            if (healthBatched) healthDirty = true;
+            else unindexHealth(index);
+        }
+        for (auto& q : queries)
+            if (q.posOf[index] != kNotMember) removeMember(q, index);
+        indexOf.erase(it);
 
-        if (index != lastIndex) {
+        if (stableOrder) {
+            // Shift the tail down one slot: O(n), but iteration order is kept
+            for (size_t i = index; i < lastIndex; ++i) moveSlot(i + 1, i);
+        } else if (index != lastIndex) {
             // Move last entity into removed slot
-            entities[index] = std::move(entities[lastIndex]);
-            indexOf[entities[index].id] = index;
+            moveSlot(lastIndex, index);
         }
 
-        entities.pop_back();
-        indexOf.erase(it);
+        popSlot();
+    }
+
+    // Keep iteration order stable across removals (shift instead of swap-and-pop).
+    void setStableOrder(bool enabled) { stableOrder = enabled; }
+    bool isStableOrder() const { return stableOrder; }
+
+    // ---------------- Incremental reordering ----------------
+
+    // Bottom-up stable merge sort of r.plan by key, resumable: moves at most
+    // `budget` entries (deducted) and returns true once the plan is sorted.
+    static bool mergeStep(ReorderPass& r, size_t& budget) {
+        const size_t n = r.plan.size();
+        while (r.width < n) {
+            size_t mid = std::min(r.lo + r.width, n);
+            size_t hi = std::min(r.lo + 2 * r.width, n);
+            for (; budget && r.out < hi; --budget) {
+                if (r.right >= hi || (r.left < mid && r.plan[r.left].first <= r.plan[r.right].first))
+                    r.scratch[r.out++] = r.plan[r.left++];
+                else
+                    r.scratch[r.out++] = r.plan[r.right++];
+            }
+            if (r.out < hi) return false;
+            r.lo = hi;
+            if (r.lo >= n) {
+                r.plan.swap(r.scratch);
+                r.width *= 2;
+                r.lo = 0;
+            }
+            r.left = r.out = r.lo;
+            r.right = std::min(r.lo + r.width, n);
+        }
+        return true;
+    }
+
+    // Start a pass that sorts entities by `key` (ties keep their current
+    // relative order). Nothing runs until reorderStep(); a pass already
+    // running is abandoned.
+    void beginReorder(std::function<uint64_t(const Entity&)> key) {
+        reorder = std::make_unique<ReorderPass>();
+        reorder->key = std::move(key);
+        reorder->plan.reserve(entities.size());
+        reorder->scratch.reserve(entities.size());
+    }
+
+    // Advance the running pass by at most `budget` units of work, so a tick
+    // never pays for the whole pass. The pass first keys `budget` entities
+    // per call, then merge-sorts the keys bottom-up, moving `budget` entries
+    // per call (O(n log n) in all, spread over calls), then places `budget`
+    // entities per call: each planned entity is swapped into the next slot
+    // and indexOf is fixed for both sides. Entities removed since they were
+    // keyed are skipped; entities added, or moved by a removal past the
+    // keying cursor, are left at the end for the next pass. Returns true
+    // while work remains.
+    bool reorderStep(size_t budget) {
+        if (!reorder) return false;
+        ReorderPass& r = *reorder;
+        if (r.phase == ReorderPass::Keying) {
+            // scratch grows with plan, so no step pays for all of it
+            for (; budget && r.pos < entities.size(); --budget, ++r.pos) {
+                r.plan.push_back({r.key(entities[r.pos]), entities[r.pos].id});
+                r.scratch.emplace_back();
+            }
+            if (r.pos < entities.size()) return true;
+            r.phase = ReorderPass::Sorting;
+            r.right = std::min<size_t>(1, r.plan.size());
+        }
+        if (r.phase == ReorderPass::Sorting) {
+            if (!mergeStep(r, budget)) return true;
+            r.phase = ReorderPass::Placing;
+            r.scratch = {};
+            r.pos = 0;
+        }
+        for (; budget && r.pos < r.plan.size() && r.placePos < entities.size(); --budget) {
+            auto it = indexOf.find(r.plan[r.pos++].second);
+            if (it == indexOf.end()) continue;
+            size_t index = it->second;
+            if (index < r.placePos) continue;       // displaced by a removal, leave it
+            if (index != r.placePos) swapSlots(index, r.placePos);
+            ++r.placePos;
+        }
+        if (r.pos < r.plan.size() && r.placePos < entities.size()) return true;
+        reorder.reset();
+        return false;
+    }
+
+    bool reorderPending() const { return reorder != nullptr; }
+
+    // ---------------- Health range index ----------------
+
+    // Index health in `buckets` equal-width buckets over [lo, hi). Incremental
+    // mode updates the index on every mutation in O(1); batched mode only
+    // marks it dirty and rebuilds once, in O(n), on the next query.
+    void enableHealthIndex(float lo, float hi, uint32_t buckets, bool batched = false) {
+        if (buckets == 0 || !(hi > lo)) return;
+        healthLo = lo;
+        healthScale = static_cast<float>(buckets) / (hi - lo);
+        healthBatched = batched;
+        healthBuckets.assign(buckets, RangeBucket{});
+        rebuildHealthIndex();
+    }
+
+    void disableHealthIndex() {
+        healthBuckets.clear();
+        healthBuckets.shrink_to_fit();
+        healthDirty = false;
+    }
+
+    void rebuildHealthIndex() {
+        for (auto& b : healthBuckets) {
+            b.ids.clear();
+            b.values.clear();
+        }
+        for (size_t i = 0; i < entities.size(); ++i) indexHealth(i);
+        healthDirty = false;
+    }
+
+    // Append ids of entities with lo <= health < hi to `out`, which needs
+    // only push_back (whole buckets use a range insert where there is one).
+    // With the index this is O(buckets + k); without it, a full scan.
+    template <class Out>
+    void queryHealthRange(float lo, float hi, Out& out) {
+        if (healthBuckets.empty()) {
+            for (auto const& e : entities)
+                if (e.health >= lo && e.health < hi) out.push_back(e.id);
+            return;
+        }
+        if (healthDirty) rebuildHealthIndex();
+        if (!(hi > lo)) return;
+
+        // Bucket mapping is monotonic, so buckets strictly between those of
+        // lo and hi hold only matches; the two end buckets need filtering.
+        uint32_t first = healthBucketOf(lo), last = healthBucketOf(hi);
+        for (uint32_t b = first; b <= last; ++b) {
+            const RangeBucket& bucket = healthBuckets[b];
+            if (b != first && b != last) {
+                if constexpr (requires { out.insert(out.end(), bucket.ids.begin(), bucket.ids.end()); })
+                    out.insert(out.end(), bucket.ids.begin(), bucket.ids.end());
+                else
+                    for (int id : bucket.ids) out.push_back(id);
+                continue;
+            }
+            if (rangeScratch.size() < bucket.values.size()) rangeScratch.resize(bucket.values.size());
+            size_t hits = simd::kernels().selectInRange(bucket.values.data(), bucket.values.size(), lo, hi,
+                                                        rangeScratch.data());
+            for (size_t i = 0; i < hits; ++i) out.push_back(bucket.ids[rangeScratch[i]]);
+        }
+    }
+
+    size_t size() const { return entities.size(); }
+
+    // Dense-slot access, for systems that iterate by index.
+    Entity& entityAt(size_t index) { return entities[index]; }
+    const Entity& entityAt(size_t index) const { return entities[index]; }
+
+    // ---------------- Cached queries ----------------
+
+    using QueryId = size_t;
+
+    // Register a persistent filter. `fields` names the columns `pred` reads;
+    // the match set is updated only when one of them changes, and follows
+    // entities through swap-and-pop, reordering and removal. Writes made
+    // through getEntity() need markChanged() to be seen.
+    QueryId registerQuery(std::function<bool(const Entity&)> pred, uint8_t fields) {
+        queries.push_back({std::move(pred), fields, {}, {}});
+        rebuildQuery(queries.size() - 1);
+        return queries.size() - 1;
+    }
+
+    void unregisterQuery(QueryId q) {
+        queries[q] = CachedQuery{};
+    }
+
+    void rebuildQuery(QueryId id) {
+        CachedQuery& q = queries[id];
+        q.members.clear();
+        q.posOf.assign(entities.size(), kNotMember);
+        if (!q.pred) return;
+        for (size_t i = 0; i < entities.size(); ++i)
+            if (q.pred(entities[i])) addMember(q, i);
+    }
+
+    size_t queryCount(QueryId q) const { return queries[q].members.size(); }
+
+    // Ids of the current matches, copied into a frame arena.
+    std::span<int> queryIds(QueryId q, FrameArena& arena) const {
+        std::span<int> out = arena.allocateArray<int>(queries[q].members.size());
+        for (size_t i = 0; i < out.size(); ++i) out[i] = entities[queries[q].members[i]].id;
+        return out;
+    }
+
+    // Dense slot indices of the current matches, in no particular order.
+    std::span<const uint32_t> queryMatches(QueryId q) const { return queries[q].members; }
+
+    // fn(Entity&) for each match: O(matches). fn must not mutate through
+    // tracked APIs, since that can reshuffle the match list mid-iteration.
+    template <class Fn>
+    void forEachMatch(QueryId q, Fn&& fn) {
+        for (uint32_t index : queries[q].members) fn(entities[index]);
+    }
+
+    // Tracked mutations. Writes made directly through getEntity() must be
+    // reported with markChanged() to show up in deltas.
+    bool setHealth(int id, float health) {
+        auto it = indexOf.find(id);
+        if (it == indexOf.end()) return false;
+        setHealthAt(it->second, health);
+        return true;
+    }
+
+    bool setName(int id, std::string_view name) {
+        auto it = indexOf.find(id);
+        if (it == indexOf.end()) return false;
+        setNameAt(it->second, names.intern(name));
+        return true;
+    }
+
+    const std::string& nameOf(const Entity& e) const { return names.name(e.name); }
+    const NamePool& namePool() const { return names; }
+
+    // Ids of all live entities with the given name, in no particular order.
+    std::span<const int> entitiesNamed(std::string_view name) const {
+        NameId sym = names.find(name);
+        if (sym == NamePool::kNone || sym >= byName.size()) return {};
+        return byName[sym];
+    }
+
+    bool markChanged(int id, uint8_t fields) {
+        auto it = indexOf.find(id);
+        if (it == indexOf.end()) return false;
+        fields &= EntityField::All;
+        if (fields) fieldsChanged(it->second, fields);
+        return true;
+    }
+
+    // Version that new changes are currently tagged with.
+    uint64_t currentVersion() const { return version; }
+
+    // Most journal records kept; beyond it the whole journal is dropped and
+    // lagging clients need a full snapshot. Lower it when nothing replicates.
+    void setJournalLimit(size_t records) {
+        journalLimit = std::max<size_t>(records, 1);
+        if (journal.size() > journalLimit) dropJournal();
+    }
+    size_t journalSize() const { return journal.size(); }
+
+    // Drop journal records a client has acknowledged (version <= acked).
+    void trimJournal(uint64_t acked) {
+        auto keep = std::upper_bound(journal.begin(), journal.end(), acked,
+            [](uint64_t v, const ChangeRecord& r) { return v < r.version; });
+        journalBase += static_cast<uint64_t>(keep - journal.begin());
+        journal.erase(journal.begin(), keep);
+        trimmedThrough = std::max(trimmedThrough, acked);
+    }
+
+    // Encode everything that changed after version `since` into `out` and
+    // close the current version. Returns the version the client is at after
+    // applying the delta (pass it as `since` next time), or 0 if the journal
+    // no longer reaches back to `since` and a full snapshot is needed.
+    //
+    // Layout (varints, ids zigzag-encoded):
+    //   adds:    count, { id, nameLen, name bytes, health f32 }
+    //   removes: count, { id }
+    //   changes: count, { id, fields u8, [nameLen, name bytes], [health f32] }
+    uint64_t encodeDelta(uint64_t since, std::vector<uint8_t>& out) {
+        if (since < trimmedThrough) return 0;
+        auto first = std::upper_bound(journal.begin(), journal.end(), since,
+            [](uint64_t v, const ChangeRecord& r) { return v < r.version; });
+
+        struct Acc { uint8_t firstFields; uint8_t fields; };
+        std::unordered_map<int, Acc> touched;
+        std::vector<int> order;                         // first-touch order, for stable output
+        touched.reserve(static_cast<size_t>(journal.end() - first));
+        for (auto it = first; it != journal.end(); ++it) {
+            auto [pos, inserted] = touched.try_emplace(it->id, Acc{it->fields, 0});
+            if (inserted) order.push_back(it->id);
+            pos->second.fields |= it->fields;
+        }
+
+        std::vector<size_t> adds, changes;
+        std::vector<int> removes;
+        for (int id : order) {
+            const Acc& a = touched[id];
+            bool existedBefore = !(a.firstFields & EntityField::Added);
+            auto live = indexOf.find(id);
+            if (live == indexOf.end()) {
+                if (existedBefore) removes.push_back(id);
+            } else if (!existedBefore || (a.fields & EntityField::Removed)) {
+                adds.push_back(live->second);           // new, or removed and re-added
+            } else {
+                changes.push_back(live->second);
+            }
+        }
+
+        auto putName = [&](const std::string& n) {
+            putVarint(out, n.size());
+            out.insert(out.end(), n.begin(), n.end());
+        };
+        auto putFloat = [&](float f) {
+            uint8_t b[sizeof(float)];
+            std::memcpy(b, &f, sizeof(f));
+            out.insert(out.end(), b, b + sizeof(b));
+        };
+
+        putVarint(out, adds.size());
+        for (size_t i : adds) {
+            putVarint(out, zigzag(entities[i].id));
+            putName(nameOf(entities[i]));
+            putFloat(entities[i].health);
+        }
+        putVarint(out, removes.size());
+        for (int id : removes) putVarint(out, zigzag(id));
+        putVarint(out, changes.size());
+        for (size_t i : changes) {
+            uint8_t fields = touched[entities[i].id].fields & EntityField::All;
+            putVarint(out, zigzag(entities[i].id));
+            out.push_back(fields);
+            if (fields & EntityField::Name) putName(nameOf(entities[i]));
+            if (fields & EntityField::Health) putFloat(entities[i].health);
+        }
+
+        return version++;
     }
 
+    // Apply a delta produced by encodeDelta(). Returns false on malformed input.
+    bool applyDelta(const std::vector<uint8_t>& in) {
+        const uint8_t* p = in.data();
+        const uint8_t* end = p + in.size();
+        uint64_t v = 0;
+
+        auto getName = [&](std::string& n) {
+            uint64_t len;
+            if (!getVarint(p, end, len) || len > uint64_t(end - p)) return false;
+            n.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(len));
+            p += len;
+            return true;
+        };
+        auto getFloat = [&](float& f) {
+            if (end - p < static_cast<std::ptrdiff_t>(sizeof(float))) return false;
+            std::memcpy(&f, p, sizeof(f));
+            p += sizeof(f);
+            return true;
+        };
+
+        if (!getVarint(p, end, v)) return false;
+        for (uint64_t n = v; n; --n) {
+            uint64_t id;
+            std::string name;
+            float health;
+            if (!getVarint(p, end, id) || !getName(name) || !getFloat(health)) return false;
+            upsertEntity(unzigzag(id), name, health);
+        }
+        if (!getVarint(p, end, v)) return false;
+        for (uint64_t n = v; n; --n) {
+            uint64_t id;
+            if (!getVarint(p, end, id)) return false;
+            removeEntity(unzigzag(id));
+        }
+        if (!getVarint(p, end, v)) return false;
+        for (uint64_t n = v; n; --n) {
+            uint64_t id;
+            if (!getVarint(p, end, id) || p == end) return false;
+            uint8_t fields = *p++;
+            std::string name;
+            float health = 0.f;
+            if ((fields & EntityField::Name) && !getName(name)) return false;
+            if ((fields & EntityField::Health) && !getFloat(health)) return false;
+            if (fields & EntityField::Name) setName(unzigzag(id), name);
+            if (fields & EntityField::Health) setHealth(unzigzag(id), health);
+        }
+        return p == end;
+    }
+
+    // Write all entities as columns (see SnapshotHeader). Each column is
+    // staged once and written with a single fwrite.
+    bool saveSnapshot(const std::string& path) const {
+        const size_t n = entities.size();
+        const size_t symbols = names.size();
+        std::vector<int32_t> ids(n);
+        std::vector<float> healths(n);
+        std::vector<uint32_t> nameIds(n);
+        std::vector<SnapshotIndexEntry> sorted;
+        sorted.reserve(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            const Entity& e = entities[i];
+            ids[i] = e.id;
+            healths[i] = e.health;
+            nameIds[i] = e.name;            // pool ids double as symbol table indices
+            sorted.push_back({e.id, static_cast<uint32_t>(i)});
+        }
+
+        // The whole pool is written as the symbol table, once per snapshot.
+        std::vector<uint32_t> offsets(symbols + 1);
+        std::string blob;
+        for (size_t s = 0; s < symbols; ++s) {
+            offsets[s] = static_cast<uint32_t>(blob.size());
+            blob += names.name(static_cast<NameId>(s));
+            if (blob.size() > UINT32_MAX) return false;
+        }
+        offsets[symbols] = static_cast<uint32_t>(blob.size());
+        const uint64_t blobBytes = blob.size();
+
+        std::sort(sorted.begin(), sorted.end(),
+            [](const SnapshotIndexEntry& a, const SnapshotIndexEntry& b) { return a.id < b.id; });
+
+        SnapshotHeader h{};
+        std::memcpy(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+        h.version = kSnapshotVersion;
+        h.symbols = static_cast<uint32_t>(symbols);
+        h.count = n;
+        h.blobBytes = blobBytes;
+
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        static const char zeros[8] = {};
+        uint64_t written = 0;
+        bool ok = true;
+        auto section = [&](const void* p, uint64_t bytes) {
+            if (!ok) return;
+            uint64_t pad = alignSnapshot(written) - written;
+            if (pad && std::fwrite(zeros, 1, pad, f) != pad) ok = false;
+            if (bytes && std::fwrite(p, 1, bytes, f) != bytes) ok = false;
+            written += pad + bytes;
+        };
+        section(&h, sizeof(h));
+        section(ids.data(), n * sizeof(int32_t));
+        section(healths.data(), n * sizeof(float));
+        section(nameIds.data(), n * sizeof(uint32_t));
+        section(offsets.data(), (symbols + 1) * sizeof(uint32_t));
+        section(blob.data(), blobBytes);
+        section(sorted.data(), n * sizeof(SnapshotIndexEntry));
+        if (std::fclose(f) != 0) ok = false;
+        return ok;
+    }
+
+    // Replace contents with the entities of a snapshot view. A valid view
+    // has unique ids (checked by open()), so entities and indexOf agree.
+    // This is an O(n) rebuild, not a load: every entity is copied and every
+    // id inserted into indexOf, a hash table the file cannot hold directly.
+    // At 10M entities that takes about a second, mostly the inserts; readers
+    // that only need columns or id lookups can use the view instead.
+    void restoreSnapshot(const EntitySnapshotView& view) {
+        size_t n = view.size();
+        std::vector<NameId> remap(view.symbolCount());
+        for (size_t s = 0; s < remap.size(); ++s)
+            remap[s] = names.intern(view.symbol(static_cast<uint32_t>(s)));
+
+        entities.clear();
+        indexOf.clear();
+        byName.clear();
+        entities.reserve(n);
+        indexOf.reserve(n);
+        meta.assign(n, SlotMeta{kNoRecord, 0, 0, 0});
+        for (size_t i = 0; i < n; ++i) {
+            entities.push_back({view.id(i), remap[view.nameId(i)], view.health(i)});
+            indexOf.emplace(view.id(i), i);
+            linkName(i);
+        }
+        if (!healthBuckets.empty()) rebuildHealthIndex();
+        for (size_t q = 0; q < queries.size(); ++q) rebuildQuery(q);
+        // A restored world is a new baseline; earlier deltas no longer apply.
+        dropJournal();
+    }
+
+    bool loadSnapshot(const std::string& path) {
+        EntitySnapshotView view;
+        if (!view.open(path)) return false;
+        restoreSnapshot(view);
+        return true;
+    }
+
+    // Copy the current columns into a free frame and publish it. Only the
+    // simulation thread may call this; buffers are reused, so steady-state
+    // publishing does not allocate.
+    uint64_t publishFrame() {
+        if (!publishedNames || publishedNames->size() != names.size()) {
+            auto table = std::make_shared<std::vector<std::string>>();
+            table->reserve(names.size());
+            for (size_t s = 0; s < names.size(); ++s) table->push_back(names.name(static_cast<NameId>(s)));
+            publishedNames = std::move(table);
+        }
+
+        EntityFrame* f = frames->writable();
+        size_t n = entities.size();
+        f->ids.resize(n);
+        f->names.resize(n);
+        f->health.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            const Entity& e = entities[i];
+            f->ids[i] = e.id;
+            f->names[i] = e.name;
+            f->health[i] = e.health;
+        }
+        f->nameTable = publishedNames;
+        f->version = version;
+        frames->publish(f);
+        return f->version;
+    }
+
+    // Safe to call from any thread, concurrently with the writer.
+    EntityFrameView acquireFrame() const { return frames->acquire(); }
+
     // Iterate over all entities (perfect locality!)
     void printAll() const {
         for (auto const& e : entities) {
-            std::cout << "Entity " << e.id << " (" << e.name
+            std::cout << "Entity " << e.id << " (" << nameOf(e)
                       << ") health=" << e.health << "\n";
         }
     }
 };
 
+using EntityManager = BasicEntityManager<std::vector<Entity>>;
+using ChunkedEntityManager = BasicEntityManager<ChunkedVector<Entity>>;
+
+// ---------------- System scheduler ----------------
+
+// Runs per-tick systems over an entity manager. Each system declares the
+// EntityField columns it reads and writes; systems that do not conflict run
+// concurrently on the pool, others run in registration order. Systems may
+// read and write entity fields in place but must not add or remove entities.
+template <class Manager>
+class SystemScheduler {
+public:
+    class Context {
+        SystemScheduler& sched;
+
+    public:
+        explicit Context(SystemScheduler& s) : sched(s) {}
+
+        Manager& manager() { return sched.mgr; }
+
+        // Scratch memory for this tick, private to the calling thread.
+        FrameArena& arena() { return sched.arenas.local(); }
+
+        // fn(begin, end) over dense slots, in parallel chunks.
+        template <class Fn>
+        void forEachChunk(Fn&& fn, size_t grain = 4096) {
+            sched.pool.parallelFor(sched.mgr.size(), grain, fn);
+        }
+
+        // fn(Entity&) for every entity, in parallel chunks.
+        template <class Fn>
+        void forEach(Fn&& fn, size_t grain = 4096) {
+            forEachChunk([&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) fn(sched.mgr.entityAt(i));
+            }, grain);
+        }
+
+        // Report an in-place write; applied to change tracking and indexes
+        // when the tick ends. Safe to call from parallel chunks.
+        void markChanged(int id, uint8_t fields) {
+            sched.pendingMarks[sched.pool.currentSlot()].push_back({id, fields});
+        }
+    };
+
+    struct SystemStats {
+        std::string name;
+        uint8_t reads, writes;
+        double startMs = 0, endMs = 0;     // within the last tick
+        double totalMs = 0;
+        uint64_t runs = 0;
+        bool critical = false;             // on the last tick's critical path
+    };
+
+private:
+    struct System {
+        std::function<void(Context&)> fn;
+        std::vector<size_t> successors;
+        size_t dependencies = 0;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    Manager& mgr;
+    ThreadPool& pool;
+    std::vector<System> systems;
+    std::vector<SystemStats> stats;
+    std::vector<std::vector<std::pair<int, uint8_t>>> pendingMarks;   // per pool slot
+    TickArena arenas;                                                 // reset after every tick
+    bool graphBuilt = false;
+    double lastTickMs = 0, criticalMs = 0;
+
+    static bool conflicts(const SystemStats& a, const SystemStats& b) {
+        return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+    }
+
+    void buildGraph() {
+        for (auto& s : systems) {
+            s.successors.clear();
+            s.dependencies = 0;
+        }
+        for (size_t j = 0; j < systems.size(); ++j)
+            for (size_t i = 0; i < j; ++i)
+                if (conflicts(stats[i], stats[j])) {
+                    systems[i].successors.push_back(j);
+                    ++systems[j].dependencies;
+                }
+        graphBuilt = true;
+    }
+
+    // Longest chain of dependent systems by last-tick duration.
+    void markCriticalPath() {
+        size_t n = systems.size();
+        std::vector<double> finish(n, 0);
+        std::vector<size_t> via(n, SIZE_MAX);
+        for (size_t i = 0; i < n; ++i) {
+            stats[i].critical = false;
+            finish[i] += stats[i].endMs - stats[i].startMs;
+            for (size_t j : systems[i].successors)
+                if (finish[i] > finish[j]) { finish[j] = finish[i]; via[j] = i; }
+        }
+        size_t last = std::max_element(finish.begin(), finish.end()) - finish.begin();
+        criticalMs = finish[last];
+        for (size_t i = last; i != SIZE_MAX; i = via[i]) stats[i].critical = true;
+    }
+
+public:
+    SystemScheduler(Manager& m, ThreadPool& p)
+        : mgr(m), pool(p), pendingMarks(p.threadCount() + 1) {}
+
+    size_t addSystem(std::string name, uint8_t reads, uint8_t writes, std::function<void(Context&)> fn) {
+        systems.push_back({std::move(fn), {}, 0});
+        stats.push_back({std::move(name), reads, writes});
+        graphBuilt = false;
+        return systems.size() - 1;
+    }
+
+    void tick() {
+        if (systems.empty()) return;
+        if (!graphBuilt) buildGraph();
+
+        auto tickStart = Clock::now();
+        auto ms = [&](Clock::time_point t) {
+            return std::chrono::duration<double, std::milli>(t - tickStart).count();
+        };
+
+        std::unique_ptr<std::atomic<size_t>[]> remaining(new std::atomic<size_t>[systems.size()]);
+        for (size_t i = 0; i < systems.size(); ++i) remaining[i] = systems[i].dependencies;
+        std::mutex doneMutex;
+        std::condition_variable doneCv;
+        size_t finished = 0;
+
+        std::function<void(size_t)> run = [&](size_t i) {
+            Context ctx(*this);
+            stats[i].startMs = ms(Clock::now());
+            systems[i].fn(ctx);
+            stats[i].endMs = ms(Clock::now());
+            stats[i].totalMs += stats[i].endMs - stats[i].startMs;
+            ++stats[i].runs;
+            for (size_t j : systems[i].successors)
+                if (remaining[j].fetch_sub(1) == 1) pool.submit([&run, j] { run(j); });
+            std::lock_guard<std::mutex> lock(doneMutex);
+            ++finished;
+            doneCv.notify_one();
+        };
+
+        for (size_t i = 0; i < systems.size(); ++i)
+            if (systems[i].dependencies == 0) pool.submit([&run, i] { run(i); });
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCv.wait(lock, [&] { return finished == systems.size(); });
+        }
+        lastTickMs = ms(Clock::now());
+
+        for (auto& marks : pendingMarks) {
+            for (auto [id, fields] : marks) mgr.markChanged(id, fields);
+            marks.clear();
+        }
+        markCriticalPath();
+        arenas.reset();
+    }
+
+    const std::vector<SystemStats>& systemStats() const { return stats; }
+    double lastTickDurationMs() const { return lastTickMs; }
+    double criticalPathMs() const { return criticalMs; }
+
+    void printReport(std::ostream& os) const {
+        os << "tick " << lastTickMs << " ms, critical path " << criticalMs << " ms\n";
+        for (auto const& s : stats) {
+            os << (s.critical ? " * " : "   ") << s.name << ": " << (s.endMs - s.startMs)
+               << " ms [" << s.startMs << ", " << s.endMs << "], avg "
+               << (s.runs ? s.totalMs / s.runs : 0.0) << " ms\n";
+        }
+    }
+};
+
+#ifndef SIMPLE_MAPS_NO_MAIN
 // ---------------- Example Usage ----------------
 int main() {
     EntityManager mgr;
@@ -76,4 +1702,132 @@ int main() {
     if (auto* e = mgr.getEntity(3)) {
         std::cout << "Found entity " << e->id << " with health " << e->health << "\n";
     }
+
+    // Snapshot round trip
+    mgr.addEntity(4, "Goblin", 35.f);
+    if (mgr.saveSnapshot("entities.snap")) {
+        EntitySnapshotView view;
+        if (view.open("entities.snap")) {
+            size_t i = view.indexOfId(4);
+            std::cout << "\nSnapshot has " << view.size() << " entities, id 4 is "
+                      << view.name(i) << "\n";
+        }
+
+        EntityManager restored;
+        if (restored.loadSnapshot("entities.snap")) {
+            std::cout << "Restored:\n";
+            restored.printAll();
+        }
+        std::remove("entities.snap");
+    }
+
+    // Query by interned name
+    mgr.addEntity(6, "Orc", 90.f);
+    std::cout << "\nOrcs:";
+    for (int id : mgr.entitiesNamed("Orc")) std::cout << " " << id;
+    std::cout << "\n";
+
+    // Group entities by name, a few moves per tick
+    mgr.beginReorder([](const Entity& e) { return uint64_t(e.name); });
+    while (mgr.reorderStep(2)) {}
+    std::cout << "\nAfter reorder by name:\n";
+    mgr.printAll();
+
+    // Cached query, kept up to date by mutations
+    auto lowHealth = mgr.registerQuery([](const Entity& e) { return e.health < 50.f; }, EntityField::Health);
+    mgr.setHealth(3, 20.f);
+    std::cout << "\nLow health (cached):";
+    mgr.forEachMatch(lowHealth, [](const Entity& e) { std::cout << " " << e.id; });
+    std::cout << "\n";
+
+    // Status-returning inserts, no console output
+    EntityManager::Spawn wave[] = {{7, "Orc", 50.f}, {1, "Orc", 60.f}, {8, "Imp", 15.f}};
+    EntityManager::AddStatus status[3];
+    size_t spawned = mgr.addEntities(wave, status);
+    std::cout << "\nSpawned " << spawned << " of 3, id 1 "
+              << (status[1] == EntityManager::AddStatus::Exists ? "already existed" : "added") << "\n";
+    mgr.upsertEntity(1, "Orc", 60.f);
+
+    // Batched lookup
+    int wanted[] = {1, 2, 4};
+    Entity* resolved[3];
+    std::cout << "\nBatch resolved " << mgr.getEntities(wanted, resolved) << " of 3 ids\n";
+
+    // Health range index
+    mgr.enableHealthIndex(0.f, 200.f, 20);
+    FrameArena arena;
+    ArenaVector<int> weak{ArenaAllocator<int>(arena)};
+    mgr.queryHealthRange(0.f, 50.f, weak);
+    std::cout << "\nEntities below 50 health:";
+    for (int id : weak) std::cout << " " << id;
+    std::cout << "\n";
+    arena.reset();
+
+    // Chunked storage: growth never moves existing entities
+    ChunkedEntityManager chunked;
+    chunked.addEntity(1, "Orc", 100.f);
+    Entity* first = chunked.getEntity(1);
+    for (int id = 2; id <= 5000; ++id) chunked.addEntity(id, "Elf", 80.f);
+    std::cout << "Chunked: " << chunked.size() << " entities, first entity "
+              << (first == chunked.getEntity(1) ? "did not move" : "moved") << "\n";
+
+    // Systems that touch disjoint columns run concurrently
+    ThreadPool pool;
+    SystemScheduler<ChunkedEntityManager> scheduler(chunked, pool);
+    // In-place writes are reported with markChanged() so the journal and
+    // indexes see them when the tick ends.
+    scheduler.addSystem("regen", EntityField::Health, EntityField::Health, [](auto& ctx) {
+        ctx.forEach([&](Entity& e) {
+            e.health += 1.f;
+            ctx.markChanged(e.id, EntityField::Health);
+        });
+    });
+    scheduler.addSystem("count-elves", EntityField::Name, 0, [](auto& ctx) {
+        std::atomic<size_t> elves{0};
+        NameId elf = ctx.manager().namePool().find("Elf");
+        ctx.forEach([&](Entity& e) { if (e.name == elf) elves.fetch_add(1, std::memory_order_relaxed); });
+    });
+    scheduler.addSystem("find-dying", EntityField::Health, 0, [](auto& ctx) {
+        ctx.forEachChunk([&](size_t begin, size_t end) {
+            ArenaVector<int> dying{ArenaAllocator<int>(ctx.arena())};
+            for (size_t i = begin; i < end; ++i)
+                if (ctx.manager().entityAt(i).health < 1.f) dying.push_back(ctx.manager().entityAt(i).id);
+        });
+    });
+    scheduler.addSystem("clamp", EntityField::Health, EntityField::Health, [](auto& ctx) {
+        ctx.forEach([&](Entity& e) {
+            if (e.health <= 100.f) return;
+            e.health = 100.f;
+            ctx.markChanged(e.id, EntityField::Health);
+        });
+    });
+    scheduler.tick();
+    scheduler.printReport(std::cout);
+
+    // Published frame for reader threads
+    mgr.publishFrame();
+    if (auto view = mgr.acquireFrame()) {
+        mgr.setHealth(6, 10.f);                  // does not affect the published frame
+        std::cout << "Frame has " << view.size() << " entities, last is "
+                  << view.name(view.size() - 1) << " with health " << view.health(view.size() - 1) << "\n";
+        std::cout << view.countHealthInRange(0.f, 50.f) << " of them below 50 health ("
+                  << simd::levelName(simd::activeLevel()) << " scan)\n";
+    }
+
+    // Delta replication
+    EntityManager client;
+    std::vector<uint8_t> delta;
+    uint64_t acked = mgr.encodeDelta(0, delta);
+    client.applyDelta(delta);
+
+    mgr.setHealth(1, 42.f);
+    mgr.removeEntity(3);
+    mgr.addEntity(5, "Troll", 300.f);
+    delta.clear();
+    acked = mgr.encodeDelta(acked, delta);
+    mgr.trimJournal(acked);
+    std::cout << "\nDelta is " << delta.size() << " bytes, client after apply:\n";
+    client.applyDelta(delta);
+    client.printAll();
 }
+#endif